@@ -1,6 +1,7 @@
 dist_noinst_DATA = \
 	etc/felt/data.dat \
 	etc/felt/stations.nc \
+	etc/felt/stations_outside.nc \
 	etc/felt/expected.txt \
 	etc/grib1/data.grib \
 	etc/grib1/stations.nc \
@@ -53,4 +54,21 @@ dist_netcdf_DATA = \
                                            etc/netcdf/valueparameter.conf
 
 CLEANFILES += \
-           result.txt
+           result.txt \
+           result.bin \
+           result.nc \
+           result.txt.0 \
+           result.txt.1 \
+           result.txt.2 \
+           result_serial.out \
+           result_serial.out.0 \
+           result_serial.out.1 \
+           result_parallel.out \
+           result_parallel.out.0 \
+           result_parallel.out.1 \
+           result_values.txt \
+           expected_values.txt \
+           expected_twice.txt \
+           result_outside.txt \
+           result_slabs.txt \
+           levelparameter_30.conf
@@ -0,0 +1,194 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "BinaryPointReader.hpp"
+#include "FastloadWriter.hpp"
+
+// std
+#include <istream>
+#include <ostream>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+    BinaryPointReader::BinaryPointReader(std::istream& in) : in_(in), validTimes_(0) { }
+
+    BinaryPointReader::~BinaryPointReader() { }
+
+    void BinaryPointReader::decode(std::ostream& out)
+    {
+        readHeader();
+
+        // state of the line currently being expanded
+        size_t entry = size_t(-1);
+        size_t level = size_t(-1);
+        int version = -1;
+        size_t maxVersion = size_t(-1);
+
+        for(;;) {
+            int tag = in_.get();
+            if(tag == char_traits<char>::eof())
+                break;
+
+            switch(tag) {
+            case binary::Stations:
+                readStations();
+                break;
+            case binary::Times:
+                readTimes();
+                break;
+            case binary::Entry:
+                readEntry();
+                break;
+            case binary::DataProvider:
+                drain(out);
+                out << FastloadWriter::dataProviderLine(readString());
+                break;
+            case binary::Records:
+            {
+                records_.resize(readU32());
+                if(records_.empty())
+                    break;
+                read(reinterpret_cast<char*>(&records_[0]), records_.size() * sizeof(binary::Record));
+                for(size_t r = 0; r < records_.size(); ++r) {
+                    const binary::Record& record = records_[r];
+                    if(record.entry != entry) {
+                        if(record.entry >= entries_.size())
+                            throw runtime_error("Binary point data refers to an undefined parameter");
+                        entry = record.entry;
+                        formatter_.setParameter(entries_[entry].first, entries_[entry].second);
+                    }
+                    if(record.level != level) {
+                        level = record.level;
+                        formatter_.setLevel(level);
+                    }
+                    if(record.version != version || record.maxVersion != maxVersion) {
+                        version = record.version;
+                        maxVersion = record.maxVersion;
+                        formatter_.setVersion(version, maxVersion);
+                    }
+                    if(record.station >= wkts_.size())
+                        throw runtime_error("Binary point data refers to an undefined station");
+                    if(record.time >= validTimes_)
+                        throw runtime_error("Binary point data refers to an undefined valid time");
+                    formatter_.append(record.value, wkts_[record.station], record.time);
+                    if(formatter_.full())
+                        drain(out);
+                }
+                break;
+            }
+            default:
+                throw runtime_error("Corrupt binary point data: unknown block");
+            }
+        }
+        drain(out);
+    }
+
+    void BinaryPointReader::readHeader()
+    {
+        char magic[sizeof(binary::magic)];
+        read(magic, sizeof(magic));
+        if(memcmp(magic, binary::magic, sizeof(magic)) != 0)
+            throw runtime_error("Not a binary point data stream");
+        if(readU32() != binary::formatVersion)
+            throw runtime_error("Unsupported binary point data version");
+        if(readU32() != binary::byteOrderMark)
+            throw runtime_error("Binary point data was written with another byte order");
+    }
+
+    void BinaryPointReader::readStations()
+    {
+        wkts_.resize(readU32());
+        for(size_t i = 0; i < wkts_.size(); ++i)
+            wkts_[i] = readString();
+    }
+
+    void BinaryPointReader::readTimes()
+    {
+        formatter_.setReferenceTime(readString());
+        vector<string> times(readU32());
+        for(size_t u = 0; u < times.size(); ++u)
+            times[u] = readString();
+        formatter_.setValidTimes(times);
+        validTimes_ = times.size();
+    }
+
+    void BinaryPointReader::readEntry()
+    {
+        boost::uint16_t index = readU16();
+        string parameter = readString();
+        string levelName = readString();
+        if(index != entries_.size())
+            throw runtime_error("Corrupt binary point data: parameters out of order");
+        entries_.push_back(make_pair(parameter, levelName));
+    }
+
+    void BinaryPointReader::drain(std::ostream& out)
+    {
+        out.write(formatter_.data(), formatter_.size());
+        formatter_.clear();
+    }
+
+    boost::uint32_t BinaryPointReader::readU32()
+    {
+        boost::uint32_t value;
+        read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    }
+
+    boost::uint16_t BinaryPointReader::readU16()
+    {
+        boost::uint16_t value;
+        read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    }
+
+    string BinaryPointReader::readString()
+    {
+        string value(readU32(), '\0');
+        if(!value.empty())
+            read(&value[0], value.size());
+        return value;
+    }
+
+    void BinaryPointReader::read(char* data, size_t length)
+    {
+        in_.read(data, length);
+        if(static_cast<size_t>(in_.gcount()) != length)
+            throw runtime_error("Unexpected end of binary point data");
+    }
+
+} } } // end namespaces
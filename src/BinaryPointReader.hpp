@@ -0,0 +1,82 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef BINARYPOINTREADER_HPP
+#define BINARYPOINTREADER_HPP
+
+// project
+#include "BinaryPointWriter.hpp"
+#include "LineFormatter.hpp"
+
+// boost
+#include <boost/noncopyable.hpp>
+
+// std
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Expands a stream written by BinaryPointWriter into
+      * wdb-fastload text, exactly as FastloadWriter writes it.
+      */
+    class BinaryPointReader : boost::noncopyable
+    {
+    public:
+        BinaryPointReader(std::istream& in);
+        ~BinaryPointReader();
+
+        /// Decode the whole input stream into out
+        void decode(std::ostream& out);
+
+    private:
+        void readHeader();
+        void readStations();
+        void readTimes();
+        void readEntry();
+        void readRecords(std::ostream& out);
+        void drain(std::ostream& out);
+
+        boost::uint32_t readU32();
+        boost::uint16_t readU16();
+        std::string readString();
+        void read(char* data, size_t length);
+
+        std::istream& in_;
+        LineFormatter formatter_;
+        std::vector<std::string> wkts_;
+        size_t validTimes_;
+        std::vector<std::pair<std::string, std::string> > entries_;
+        std::vector<binary::Record> records_;
+    };
+
+} } } // end namespaces
+
+#endif // BINARYPOINTREADER_HPP
@@ -0,0 +1,196 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "BinaryPointWriter.hpp"
+#include "Loader.hpp"
+
+// boost
+#include <boost/static_assert.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+
+// std
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+namespace
+{
+    BOOST_STATIC_ASSERT(sizeof(binary::Record) == 24);
+
+    void put(string& out, boost::uint32_t value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put(string& out, boost::uint16_t value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put(string& out, const string& value)
+    {
+        put(out, boost::numeric_cast<boost::uint32_t>(value.size()));
+        out.append(value);
+    }
+}
+
+    const size_t BinaryPointWriter::recordsPerBlock;
+
+    BinaryPointWriter::BinaryPointWriter(Loader& controller, OutputWriter& output) : controller_(controller), output_(output), headerWritten_(false), drainAt_(recordsPerBlock)
+    {
+        current_ = binary::Record();
+        records_.reserve(recordsPerBlock);
+    }
+
+    BinaryPointWriter::BinaryPointWriter(const BinaryPointWriter& parent)
+        : controller_(parent.controller_), output_(parent.output_), headerWritten_(true), dataProvider_(parent.dataProvider_),
+          current_(parent.current_), drainAt_(numeric_limits<size_t>::max())
+    {
+        records_.reserve(recordsPerBlock);
+    }
+
+    BinaryPointWriter::~BinaryPointWriter() { }
+
+    void BinaryPointWriter::beginEntries(const string& referenceTime, const vector<string>& validTimes)
+    {
+        if(validTimes.size() > numeric_limits<boost::uint16_t>::max())
+            throw runtime_error("Too many valid times for binary output");
+
+        string block;
+        if(!headerWritten_) {
+            block.append(binary::magic, sizeof(binary::magic));
+            put(block, binary::formatVersion);
+            put(block, binary::byteOrderMark);
+
+            const vector<string>& wkts = controller_.wkts();
+            block += char(binary::Stations);
+            put(block, boost::numeric_cast<boost::uint32_t>(wkts.size()));
+            for(size_t i = 0; i < wkts.size(); ++i)
+                put(block, wkts[i]);
+            headerWritten_ = true;
+        }
+
+        block += char(binary::Times);
+        put(block, referenceTime);
+        put(block, boost::numeric_cast<boost::uint32_t>(validTimes.size()));
+        for(size_t u = 0; u < validTimes.size(); ++u)
+            put(block, validTimes[u]);
+        output_.write(block);
+
+        // every pass starts with a data provider block, as in the text format
+        dataProvider_.clear();
+    }
+
+    void BinaryPointWriter::beginEntry(const string& dataProvider, const string& parameter, const string& levelName)
+    {
+        drain();
+
+        string block;
+        if(dataProvider_ != dataProvider) {
+            block += char(binary::DataProvider);
+            put(block, dataProvider);
+            output_.write(block);
+            block.clear();
+            if(!dataProvider_.empty())
+                output_.flush(OutputWriter::FlushDataProvider);
+            dataProvider_ = dataProvider;
+        }
+
+        pair<string, string> key(parameter, levelName);
+        map<pair<string, string>, boost::uint16_t>::const_iterator found = entries_.find(key);
+        if(found == entries_.end()) {
+            if(entries_.size() > numeric_limits<boost::uint16_t>::max())
+                throw runtime_error("Too many parameters for binary output");
+            boost::uint16_t index = entries_.size();
+            block += char(binary::Entry);
+            put(block, index);
+            put(block, parameter);
+            put(block, levelName);
+            output_.write(block);
+            found = entries_.insert(make_pair(key, index)).first;
+        }
+        current_.entry = found->second;
+    }
+
+    void BinaryPointWriter::setLevel(size_t level)
+    {
+        current_.level = boost::numeric_cast<boost::uint32_t>(level);
+    }
+
+    void BinaryPointWriter::setVersion(int version, size_t maxVersion)
+    {
+        current_.version = boost::numeric_cast<boost::uint16_t>(version);
+        current_.maxVersion = boost::numeric_cast<boost::uint16_t>(maxVersion);
+    }
+
+    void BinaryPointWriter::endEntries()
+    {
+        drain();
+        if(!dataProvider_.empty())
+            output_.flush(OutputWriter::FlushDataProvider);
+    }
+
+    PointWriter* BinaryPointWriter::fork()
+    {
+        return new BinaryPointWriter(*this);
+    }
+
+    void BinaryPointWriter::join(PointWriter& block)
+    {
+        const vector<binary::Record>& records = static_cast<BinaryPointWriter&>(block).records_;
+        for(size_t i = 0; i < records.size(); ) {
+            size_t n = min(recordsPerBlock - records_.size(), records.size() - i);
+            records_.insert(records_.end(), records.begin() + i, records.begin() + i + n);
+            i += n;
+            if(records_.size() == recordsPerBlock)
+                drain();
+        }
+    }
+
+    void BinaryPointWriter::drain()
+    {
+        if(records_.empty())
+            return;
+        string block;
+        block += char(binary::Records);
+        put(block, boost::numeric_cast<boost::uint32_t>(records_.size()));
+        output_.write(block);
+        output_.write(reinterpret_cast<const char*>(&records_[0]), records_.size() * sizeof(binary::Record));
+        records_.clear();
+    }
+
+} } } // end namespaces
@@ -0,0 +1,135 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef BINARYPOINTWRITER_HPP
+#define BINARYPOINTWRITER_HPP
+
+// project
+#include "PointWriter.hpp"
+
+// boost
+#include <boost/cstdint.hpp>
+
+// std
+#include <map>
+#include <string>
+#include <vector>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Compact binary form of the wdb-fastload output (--output.format=binary).
+      *
+      * The stream starts with a header (magic, format version and a byte
+      * order mark), followed by tagged blocks:
+      *
+      *  'S' station table: u32 count, count strings (station WKT)
+      *  'T' time table:    string reference time, u32 count, count strings (valid times)
+      *  'E' entry:         u16 index, string parameter, string level name
+      *  'P' data provider: string name; starts a new data provider block
+      *  'R' records:       u32 count, count Record structs
+      *
+      * Strings are stored as u32 length followed by the characters.
+      * Everything is in host byte order; the decoder rejects streams
+      * written with another byte order. BinaryPointReader expands a
+      * stream back into the exact text FastloadWriter would have written.
+      */
+    namespace binary
+    {
+        const char magic[8] = { 'W', 'D', 'B', 'P', 'O', 'I', 'N', 'T' };
+        const boost::uint32_t formatVersion = 1;
+        const boost::uint32_t byteOrderMark = 0x01020304;
+
+        enum Tag
+        {
+            Stations = 'S',
+            Times = 'T',
+            Entry = 'E',
+            DataProvider = 'P',
+            Records = 'R'
+        };
+
+        /// One value; the value is kept as double so that the text can be reproduced exactly
+        struct Record
+        {
+            boost::uint32_t station;
+            boost::uint32_t level;
+            boost::uint16_t time;
+            boost::uint16_t entry;
+            boost::uint16_t version;
+            boost::uint16_t maxVersion;
+            double value;
+        };
+    }
+
+    class BinaryPointWriter : public PointWriter
+    {
+    public:
+        BinaryPointWriter(Loader& controller, OutputWriter& output);
+        ~BinaryPointWriter();
+
+        void beginEntries(const std::string& referenceTime, const std::vector<std::string>& validTimes);
+        void beginEntry(const std::string& dataProvider, const std::string& parameter, const std::string& levelName);
+        void setLevel(size_t level);
+        void setVersion(int version, size_t maxVersion);
+        void write(double value, size_t station, size_t time)
+        {
+            current_.station = station;
+            current_.time = time;
+            current_.value = value;
+            records_.push_back(current_);
+            if(records_.size() == drainAt_)
+                drain();
+        }
+        void endEntries();
+        PointWriter* fork();
+        void join(PointWriter& block);
+
+    private:
+        static const size_t recordsPerBlock = 4096;
+
+        // block of the parent's current entry (see fork); keeps all its records
+        // until join, so that the parent cuts record blocks as a serial run would
+        explicit BinaryPointWriter(const BinaryPointWriter& parent);
+
+        // write pending records as one block
+        void drain();
+
+        Loader& controller_;
+        OutputWriter& output_;
+        bool headerWritten_;
+        std::string dataProvider_;
+        std::map<std::pair<std::string, std::string>, boost::uint16_t> entries_;
+        binary::Record current_;
+        std::vector<binary::Record> records_;
+        size_t drainAt_;
+    };
+
+} } } // end namespaces
+
+#endif // BINARYPOINTWRITER_HPP
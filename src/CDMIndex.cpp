@@ -0,0 +1,124 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "CDMIndex.hpp"
+
+// libfimex
+#include <fimex/CDM.h>
+
+// std
+#include <algorithm>
+#include <stdexcept>
+
+using namespace std;
+using namespace MetNoFimex;
+
+namespace wdb { namespace load { namespace point {
+
+    bool CDMIndex::Variable::hasDimension(const string& dimension) const
+    {
+        return find(shape.begin(), shape.end(), dimension) != shape.end();
+    }
+
+    void CDMIndex::clear()
+    {
+        variables_.clear();
+        byName_.clear();
+        byStandardName_.clear();
+        dimensionLengths_.clear();
+    }
+
+    void CDMIndex::build(const CDM& cdm)
+    {
+        clear();
+
+        const vector<CDMVariable>& variables = cdm.getVariables();
+        variables_.resize(variables.size());
+        for(size_t i = 0; i < variables.size(); ++i) {
+            Variable& variable = variables_[i];
+            variable.name = variables[i].getName();
+            variable.shape = variables[i].getShape();
+
+            CDMAttribute attribute;
+            if(cdm.getAttribute(variable.name, "standard_name", attribute))
+                variable.standardName = attribute.getStringValue();
+            variable.units = cdm.getUnits(variable.name);
+
+            for(size_t d = 0; d < variable.shape.size(); ++d) {
+                const string& dimension = variable.shape[d];
+                if(dimensionLengths_.find(dimension) == dimensionLengths_.end() && cdm.hasDimension(dimension))
+                    dimensionLengths_[dimension] = cdm.getDimension(dimension).getLength();
+            }
+
+            variable.xAxis = cdm.getHorizontalXAxis(variable.name);
+            variable.yAxis = cdm.getHorizontalYAxis(variable.name);
+            variable.xLength = variable.xAxis.empty() ? 0 : cdm.getDimension(variable.xAxis).getLength();
+            variable.yLength = variable.yAxis.empty() ? 0 : cdm.getDimension(variable.yAxis).getLength();
+            variable.verticalAxis = cdm.getVerticalAxis(variable.name);
+
+            string latitude, longitude;
+            variable.hasLatitudeLongitude = cdm.getLatitudeLongitude(variable.name, latitude, longitude);
+            variable.timeDependent = variable.hasDimension("time");
+        }
+
+        // the vector is complete, pointers into it stay valid
+        for(size_t i = 0; i < variables_.size(); ++i) {
+            const Variable& variable = variables_[i];
+            byName_[variable.name] = &variable;
+            if(!variable.standardName.empty())
+                byStandardName_[variable.standardName].push_back(&variable);
+        }
+    }
+
+    const CDMIndex::Variable* CDMIndex::variable(const string& name) const
+    {
+        map<string, const Variable*>::const_iterator found = byName_.find(name);
+        return found == byName_.end() ? 0 : found->second;
+    }
+
+    const vector<const CDMIndex::Variable*>& CDMIndex::withStandardName(const string& standardName) const
+    {
+        static const vector<const Variable*> none;
+        map<string, vector<const Variable*> >::const_iterator found = byStandardName_.find(standardName);
+        return found == byStandardName_.end() ? none : found->second;
+    }
+
+    size_t CDMIndex::dimensionLength(const string& name) const
+    {
+        map<string, size_t>::const_iterator found = dimensionLengths_.find(name);
+        if(found == dimensionLengths_.end())
+            throw runtime_error("no dimension " + name + " in the data");
+        return found->second;
+    }
+
+} } } // end namespaces
@@ -0,0 +1,97 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef CDMINDEX_HPP
+#define CDMINDEX_HPP
+
+// std
+#include <map>
+#include <string>
+#include <vector>
+
+namespace MetNoFimex {
+    class CDM;
+}
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Metadata of the variables of a CDM, looked up once.
+      *
+      * Finding a variable by standard_name or its axes through the CDM
+      * scans all variables and attributes; FileLoader builds this index
+      * after interpolation so that the per-entry setup of the loaders
+      * does not grow with the number of variables in the file.
+      */
+    class CDMIndex
+    {
+    public:
+        struct Variable
+        {
+            std::string name;
+            std::string standardName;
+            std::string units;
+            std::vector<std::string> shape;
+            std::string xAxis;          // empty without horizontal axes
+            std::string yAxis;
+            size_t xLength;
+            size_t yLength;
+            std::string verticalAxis;   // empty without vertical axis
+            bool hasLatitudeLongitude;
+            bool timeDependent;         // has the time dimension
+
+            bool hasDimension(const std::string& dimension) const;
+        };
+
+        /// Index the variables of cdm, replacing what was indexed before
+        void build(const MetNoFimex::CDM& cdm);
+
+        /// Forget what was indexed
+        void clear();
+
+        const std::vector<Variable>& variables() const { return variables_; }
+
+        /// The variable called name, 0 if there is none
+        const Variable* variable(const std::string& name) const;
+
+        /// The variables with the standard_name attribute standardName
+        const std::vector<const Variable*>& withStandardName(const std::string& standardName) const;
+
+        /// Length of a dimension; throws when there is none of that name
+        size_t dimensionLength(const std::string& name) const;
+
+    private:
+        std::vector<Variable> variables_;
+        std::map<std::string, const Variable*> byName_;
+        std::map<std::string, std::vector<const Variable*> > byStandardName_;
+        std::map<std::string, size_t> dimensionLengths_;
+    };
+
+} } } // end namespaces
+
+#endif // CDMINDEX_HPP
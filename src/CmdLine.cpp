@@ -52,6 +52,15 @@ namespace
         options_description output( "Output" );
         output.add_options()
         ( "output", value(& out.outFileName), "Specify a output filename ")
+        ( "output.format", value(& out.format)->default_value("text"), "Output format [text (wdb-fastload), binary (see pointValueDecode), copy (PostgreSQL binary COPY), columnar (one array per parameter) or netcdf (station NetCDF file per input file)]")
+        ( "output.buffersize", value(& out.bufferSize)->default_value(1 << 20), "Size of output buffer in bytes")
+        ( "output.flush", value(& out.flushPolicy)->default_value("file"), "When to flush output [line, dataprovider, file or never]")
+        ( "output.queue", value(& out.queueLength)->default_value(2), "Number of filled output buffers queued for the writer thread [0 writes without a thread]")
+        ( "output.compress", value(& out.compress)->default_value("none"), "Compress output [none, gzip or zstd]")
+        ( "output.compress.level", value(& out.compressLevel)->default_value(-1), "Compression level [-1 for the method's default]")
+        ( "output.compress.threads", value(& out.compressThreads)->default_value(2), "Number of compression threads (used with output.queue > 0)")
+        ( "output.shards", value(& out.shards)->default_value(1), "Number of output files; shard n is written to <output>.n")
+        ( "output.shard.key", value(& out.shardKey)->default_value("station"), "How values are split between shards [station, parameter or time]")
         ;
 
         return output;
@@ -76,6 +85,12 @@ namespace
         ( "fimex.process.rotateVectorToLatLonY", value(&out.fimexProcessRotateVectorToLatLonY), "Rotate Y wind component to lat/lon" )
         ( "fimex.interpolate.template", value(& out.fimexTemplate), "Path to template file tha fimex reader will use for point interpolation" )
         ( "fimex.interpolate.method", value(& out.fimexInterpolateMethod), "Interpolation method [nearestneighbor, bilinear, bicubic, coord_nearestneighbor, coord_kdtree, forward_max, forward_mean, forward_median or forward_sum]" )
+        ( "threads", value(& out.threads)->default_value(1), "Number of threads formatting output values [text, binary and copy formats]" )
+        ( "slab.stations", value(& out.slabStations)->default_value(0), "Read each variable for blocks of about this many stations at a time, to bound memory use; each block decodes and interpolates the whole grid again, so the CPU time grows with the number of blocks [0 reads whole variables]" )
+        ( "memory.limit", value(& out.memoryLimit)->default_value(0), "Memory budget in MiB for the values read and staged at a time, used to size the station blocks when slab.stations is not given (a smaller budget means more blocks, each decoding and interpolating the whole grid); the peak is estimated from the block sizes and logged with the measured high-water mark [0 for no limit]" )
+        ( "prefetch", value(& out.prefetch)->default_value(size_t(-1), "1 with slabs, else 0"), "Number of slabs read ahead on a reader thread while the current one is written; each slab read ahead is held in memory, as much again as the variable when it is read whole [0 reads on the loader's thread]" )
+        ( "precision", value(& out.precision)->default_value("double"), "Precision the values are read, staged and computed in [double or float]" )
+        ( "wind.direction", value(& out.windDirection)->default_value("exact"), "How wind from directions are computed [exact with the libm atan2, or fast with a vectorized approximation within 2e-6 radians of it]" )
         ;
 
 	return input;
@@ -125,6 +140,10 @@ namespace wdb { namespace load { namespace point {
     void CmdLine::parse( int argc, char ** argv )
     {
     	WdbConfiguration::parse(argc, argv);
+    	// reading a whole variable ahead would double the memory it takes,
+    	// so slabs are read ahead only when reads are split into slabs
+    	if ( loading_.prefetch == size_t(-1) )
+    		loading_.prefetch = (loading_.slabStations > 0 or loading_.memoryLimit > 0) ? 1 : 0;
     	if ( not general().configFile.empty() )
     	{
     		boost::filesystem::path config(general().configFile);
@@ -53,6 +53,15 @@ namespace wdb { namespace load { namespace point {
         struct OutputOptions
         {
             string outFileName;
+            string format;
+            size_t bufferSize;
+            string flushPolicy;
+            size_t queueLength;
+            string compress;
+            int compressLevel;
+            size_t compressThreads;
+            size_t shards;
+            string shardKey;
         };
 
         struct InputOptions
@@ -78,6 +87,12 @@ namespace wdb { namespace load { namespace point {
             string fimexInterpolateMethod;
             string fimexProcessRotateVectorToLatLonX;
             string fimexProcessRotateVectorToLatLonY;
+            size_t threads;
+            size_t slabStations;
+            size_t memoryLimit;
+            size_t prefetch;
+            string precision;
+            string windDirection;
         };
 
         const InputOptions & input() const { return input_; }
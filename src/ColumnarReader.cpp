@@ -0,0 +1,190 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "ColumnarReader.hpp"
+#include "FastloadWriter.hpp"
+#include "LineFormatter.hpp"
+
+// std
+#include <istream>
+#include <ostream>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+    ColumnarReader::ColumnarReader(std::istream& in) : in_(in)
+    {
+        char magic[sizeof(columnar::magic)];
+        read(magic, sizeof(magic));
+        if(memcmp(magic, columnar::magic, sizeof(magic)) != 0)
+            throw runtime_error("Not a columnar point data file");
+        if(readU32() != columnar::formatVersion)
+            throw runtime_error("Unsupported columnar point data version");
+        if(readU32() != columnar::byteOrderMark)
+            throw runtime_error("Columnar point data was written with another byte order");
+
+        if(!in_.seekg(-static_cast<streamoff>(columnar::trailerSize), ios::end))
+            throw runtime_error("Columnar point data must be read from a file");
+        boost::uint64_t footerOffset = readU64();
+        read(magic, sizeof(magic));
+        if(memcmp(magic, columnar::magic, sizeof(magic)) != 0)
+            throw runtime_error("Columnar point data is incomplete (no footer)");
+        in_.seekg(footerOffset);
+
+        wkts_.resize(readU32());
+        for(size_t i = 0; i < wkts_.size(); ++i)
+            wkts_[i] = readString();
+
+        passes_.resize(readU32());
+        for(size_t p = 0; p < passes_.size(); ++p) {
+            passes_[p].referenceTime = readString();
+            passes_[p].validTimes.resize(readU32());
+            for(size_t u = 0; u < passes_[p].validTimes.size(); ++u)
+                passes_[p].validTimes[u] = readString();
+        }
+
+        columns_.resize(readU32());
+        for(size_t c = 0; c < columns_.size(); ++c) {
+            columnar::Column& column = columns_[c];
+            column.pass = readU32();
+            if(column.pass >= passes_.size())
+                throw runtime_error("Corrupt columnar point data: column refers to an undefined pass");
+            column.dataProvider = readString();
+            column.parameter = readString();
+            column.levelName = readString();
+            column.levels.resize(readU32());
+            for(size_t l = 0; l < column.levels.size(); ++l)
+                column.levels[l] = readU32();
+            column.members.resize(readU32());
+            for(size_t m = 0; m < column.members.size(); ++m)
+                column.members[m] = readU32();
+            column.maxVersion = readU32();
+            column.offset = readU64();
+            column.rows = readU64();
+        }
+    }
+
+    ColumnarReader::~ColumnarReader() { }
+
+    void ColumnarReader::read(const columnar::Column& column, vector<double>& values)
+    {
+        values.resize(column.rows * passes_[column.pass].validTimes.size());
+        if(values.empty())
+            return;
+        in_.clear();
+        in_.seekg(column.offset);
+        read(reinterpret_cast<char*>(&values[0]), values.size() * sizeof(double));
+    }
+
+    void ColumnarReader::decode(std::ostream& out)
+    {
+        LineFormatter formatter;
+        string dataProvider;
+        vector<double> values;
+
+        for(size_t c = 0; c < columns_.size(); ++c) {
+            const columnar::Column& column = columns_[c];
+            const Pass& pass = passes_[column.pass];
+
+            // every pass starts with a data provider line, as in the text format
+            if(c == 0 || column.pass != columns_[c - 1].pass) {
+                formatter.setReferenceTime(pass.referenceTime);
+                formatter.setValidTimes(pass.validTimes);
+                dataProvider.clear();
+            }
+            if(column.dataProvider != dataProvider) {
+                dataProvider = column.dataProvider;
+                out.write(formatter.data(), formatter.size());
+                formatter.clear();
+                out << FastloadWriter::dataProviderLine(dataProvider);
+            }
+            formatter.setParameter(column.parameter, column.levelName);
+
+            if(column.rows != 0 && column.rows != wkts_.size() * column.levels.size() * column.members.size())
+                throw runtime_error("Corrupt columnar point data: column shape does not match its rows");
+            read(column, values);
+            const size_t times = pass.validTimes.size();
+            const size_t levels = column.levels.size();
+            const size_t members = column.members.size();
+            for(size_t row = 0; row < column.rows; ++row) {
+                const size_t station = row / (levels * members);
+                formatter.setLevel(column.levels[row / members % levels]);
+                formatter.setVersion(column.members[row % members], column.maxVersion);
+                for(size_t u = 0; u < times; ++u) {
+                    double value = values[row * times + u];
+                    if(value != value)
+                        continue;
+                    formatter.append(value, wkts_[station], u);
+                    if(formatter.full()) {
+                        out.write(formatter.data(), formatter.size());
+                        formatter.clear();
+                    }
+                }
+            }
+        }
+        out.write(formatter.data(), formatter.size());
+    }
+
+    boost::uint32_t ColumnarReader::readU32()
+    {
+        boost::uint32_t value;
+        read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    }
+
+    boost::uint64_t ColumnarReader::readU64()
+    {
+        boost::uint64_t value;
+        read(reinterpret_cast<char*>(&value), sizeof(value));
+        return value;
+    }
+
+    string ColumnarReader::readString()
+    {
+        string value(readU32(), '\0');
+        if(!value.empty())
+            read(&value[0], value.size());
+        return value;
+    }
+
+    void ColumnarReader::read(char* data, size_t length)
+    {
+        in_.read(data, length);
+        if(static_cast<size_t>(in_.gcount()) != length)
+            throw runtime_error("Unexpected end of columnar point data");
+    }
+
+} } } // end namespaces
@@ -0,0 +1,85 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef COLUMNARREADER_HPP
+#define COLUMNARREADER_HPP
+
+// project
+#include "ColumnarWriter.hpp"
+
+// boost
+#include <boost/noncopyable.hpp>
+
+// std
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Reads a file written by ColumnarWriter: the footer on construction,
+      * the columns on demand. The input must be seekable.
+      */
+    class ColumnarReader : boost::noncopyable
+    {
+    public:
+        struct Pass
+        {
+            std::string referenceTime;
+            std::vector<std::string> validTimes;
+        };
+
+        ColumnarReader(std::istream& in);
+        ~ColumnarReader();
+
+        const std::vector<std::string>& stations() const { return wkts_; }
+        const std::vector<Pass>& passes() const { return passes_; }
+        const std::vector<columnar::Column>& columns() const { return columns_; }
+
+        /// The values of one column, indexed [station][level][member][time]
+        void read(const columnar::Column& column, std::vector<double>& values);
+
+        /// Expand all columns into wdb-fastload text, as FastloadWriter writes it
+        void decode(std::ostream& out);
+
+    private:
+        boost::uint32_t readU32();
+        boost::uint64_t readU64();
+        std::string readString();
+        void read(char* data, size_t length);
+
+        std::istream& in_;
+        std::vector<std::string> wkts_;
+        std::vector<Pass> passes_;
+        std::vector<columnar::Column> columns_;
+    };
+
+} } } // end namespaces
+
+#endif // COLUMNARREADER_HPP
@@ -0,0 +1,208 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "ColumnarWriter.hpp"
+#include "Loader.hpp"
+
+// boost
+#include <boost/numeric/conversion/cast.hpp>
+
+// std
+#include <algorithm>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+namespace
+{
+    template<typename T>
+    void put(string& out, T value)
+    {
+        out.append(reinterpret_cast<const char*>(&value), sizeof(value));
+    }
+
+    void put(string& out, const string& value)
+    {
+        put(out, boost::numeric_cast<boost::uint32_t>(value.size()));
+        out.append(value);
+    }
+
+    void put(string& out, const vector<string>& values)
+    {
+        put(out, boost::numeric_cast<boost::uint32_t>(values.size()));
+        for(size_t i = 0; i < values.size(); ++i)
+            put(out, values[i]);
+    }
+}
+
+    ColumnarWriter::ColumnarWriter(Loader& controller, OutputWriter& output)
+        : controller_(controller), output_(output), headerWritten_(false), position_(0), rowOpen_(false), columnOpen_(false), levelCalls_(0)
+    { }
+
+    ColumnarWriter::~ColumnarWriter() { }
+
+    void ColumnarWriter::beginEntries(const string& referenceTime, const vector<string>& validTimes)
+    {
+        writeHeader();
+        passes_.push_back(make_pair(referenceTime, validTimes));
+        row_.assign(validTimes.size(), numeric_limits<double>::quiet_NaN());
+        rowOpen_ = false;
+    }
+
+    void ColumnarWriter::beginEntry(const string& dataProvider, const string& parameter, const string& levelName)
+    {
+        endColumn();
+
+        columnar::Column column;
+        column.pass = boost::numeric_cast<boost::uint32_t>(passes_.size() - 1);
+        column.dataProvider = dataProvider;
+        column.parameter = parameter;
+        column.levelName = levelName;
+        column.maxVersion = 0;
+        column.offset = position_;
+        column.rows = 0;
+        columns_.push_back(column);
+        columnOpen_ = true;
+        levelCalls_ = 0;
+    }
+
+    void ColumnarWriter::setLevel(size_t level)
+    {
+        endRow();
+        ++levelCalls_;
+        vector<boost::uint32_t>& levels = columns_.back().levels;
+        boost::uint32_t value = boost::numeric_cast<boost::uint32_t>(level);
+        if(find(levels.begin(), levels.end(), value) == levels.end())
+            levels.push_back(value);
+    }
+
+    void ColumnarWriter::setVersion(int version, size_t maxVersion)
+    {
+        endRow();
+        columnar::Column& column = columns_.back();
+        if(levelCalls_ == 1)
+            column.members.push_back(version);
+        column.maxVersion = boost::numeric_cast<boost::uint32_t>(maxVersion);
+        rowOpen_ = true;
+    }
+
+    void ColumnarWriter::endEntries()
+    {
+        endColumn();
+        output_.flush(OutputWriter::FlushDataProvider);
+    }
+
+    void ColumnarWriter::close()
+    {
+        endColumn();
+        writeHeader();
+
+        boost::uint64_t footerOffset = position_;
+        string footer;
+        put(footer, controller_.wkts());
+        put(footer, boost::numeric_cast<boost::uint32_t>(passes_.size()));
+        for(size_t p = 0; p < passes_.size(); ++p) {
+            put(footer, passes_[p].first);
+            put(footer, passes_[p].second);
+        }
+        put(footer, boost::numeric_cast<boost::uint32_t>(columns_.size()));
+        for(size_t c = 0; c < columns_.size(); ++c) {
+            const columnar::Column& column = columns_[c];
+            put(footer, column.pass);
+            put(footer, column.dataProvider);
+            put(footer, column.parameter);
+            put(footer, column.levelName);
+            put(footer, boost::numeric_cast<boost::uint32_t>(column.levels.size()));
+            for(size_t l = 0; l < column.levels.size(); ++l)
+                put(footer, column.levels[l]);
+            put(footer, boost::numeric_cast<boost::uint32_t>(column.members.size()));
+            for(size_t m = 0; m < column.members.size(); ++m)
+                put(footer, column.members[m]);
+            put(footer, column.maxVersion);
+            put(footer, column.offset);
+            put(footer, column.rows);
+        }
+        put(footer, footerOffset);
+        footer.append(columnar::magic, sizeof(columnar::magic));
+        append(footer.data(), footer.size());
+    }
+
+    void ColumnarWriter::writeHeader()
+    {
+        if(headerWritten_)
+            return;
+        string header(columnar::magic, sizeof(columnar::magic));
+        put(header, columnar::formatVersion);
+        put(header, columnar::byteOrderMark);
+        append(header.data(), header.size());
+        headerWritten_ = true;
+    }
+
+    void ColumnarWriter::endRow()
+    {
+        if(!rowOpen_)
+            return;
+        append(reinterpret_cast<const char*>(&row_[0]), row_.size() * sizeof(double));
+        fill(row_.begin(), row_.end(), numeric_limits<double>::quiet_NaN());
+        ++columns_.back().rows;
+        rowOpen_ = false;
+    }
+
+    void ColumnarWriter::endColumn()
+    {
+        if(!columnOpen_)
+            return;
+        endRow();
+        columnOpen_ = false;
+
+        const columnar::Column& column = columns_.back();
+        boost::uint64_t rows = boost::uint64_t(controller_.wkts().size()) * column.levels.size() * column.members.size();
+        if(column.rows != 0 && column.rows != rows) {
+            stringstream ss;
+            ss << "Columnar output of " << column.parameter << " got " << column.rows << " rows of values, expected " << rows
+               << " (same levels and members for every station)";
+            throw runtime_error(ss.str());
+        }
+    }
+
+    void ColumnarWriter::append(const char* data, size_t length)
+    {
+        output_.write(data, length);
+        position_ += length;
+    }
+
+} } } // end namespaces
@@ -0,0 +1,138 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef COLUMNARWRITER_HPP
+#define COLUMNARWRITER_HPP
+
+// project
+#include "PointWriter.hpp"
+
+// boost
+#include <boost/cstdint.hpp>
+
+// std
+#include <string>
+#include <vector>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Columnar form of the point values (--output.format=columnar).
+      *
+      * Each entry (parameter) becomes one contiguous float64 array indexed
+      * [station][level][member][time]; values that were not loaded (NaN)
+      * are kept as NaN. A reader can map one parameter straight from the
+      * file using the footer, which describes the axes:
+      *
+      *  header:  magic, format version, byte order mark (16 bytes, so
+      *           the arrays that follow stay 8 byte aligned)
+      *  columns: the arrays, in entry order
+      *  footer:  u32 count, count strings (station WKT)
+      *           u32 count, count passes: string reference time,
+      *                                    u32 count, count strings (valid times)
+      *           u32 count, count columns: u32 pass, string data provider,
+      *                                     string parameter, string level name,
+      *                                     u32 count, count u32 (levels),
+      *                                     u32 count, count i32 (members),
+      *                                     u32 max version,
+      *                                     u64 offset, u64 rows (of time values)
+      *  trailer: u64 footer offset, magic
+      *
+      * A pass is one beginEntries/endEntries round. Strings are stored as
+      * u32 length followed by the characters; everything is in host byte
+      * order. ColumnarReader reads the footer and the columns back.
+      */
+    namespace columnar
+    {
+        const char magic[8] = { 'C', 'O', 'L', 'P', 'O', 'I', 'N', 'T' };
+        const boost::uint32_t formatVersion = 1;
+        const boost::uint32_t byteOrderMark = 0x01020304;
+        const size_t headerSize = 16;
+        const size_t trailerSize = 16;
+
+        /// Footer description of one column
+        struct Column
+        {
+            boost::uint32_t pass;
+            std::string dataProvider;
+            std::string parameter;
+            std::string levelName;
+            std::vector<boost::uint32_t> levels;
+            std::vector<boost::int32_t> members;
+            boost::uint32_t maxVersion;
+            boost::uint64_t offset;
+            boost::uint64_t rows;
+        };
+    }
+
+    class ColumnarWriter : public PointWriter
+    {
+    public:
+        ColumnarWriter(Loader& controller, OutputWriter& output);
+        ~ColumnarWriter();
+
+        void beginEntries(const std::string& referenceTime, const std::vector<std::string>& validTimes);
+        void beginEntry(const std::string& dataProvider, const std::string& parameter, const std::string& levelName);
+        void setLevel(size_t level);
+        void setVersion(int version, size_t maxVersion);
+        void write(double value, size_t station, size_t time)
+        {
+            row_[time] = value;
+        }
+        void endEntries();
+        void close();
+        // a row for every station, level and member
+        bool everyStation() const { return true; }
+
+    private:
+        void writeHeader();
+        // write the values of the current level and member
+        void endRow();
+        // check the shape of the current column
+        void endColumn();
+        void append(const char* data, size_t length);
+
+        Loader& controller_;
+        OutputWriter& output_;
+        bool headerWritten_;
+        boost::uint64_t position_;
+
+        // reference time and valid times of each pass
+        std::vector<std::pair<std::string, std::vector<std::string> > > passes_;
+        std::vector<columnar::Column> columns_;
+        // time values for one station, level and member; NaN until written
+        std::vector<double> row_;
+        bool rowOpen_;
+        bool columnOpen_;
+        // setLevel calls in the current column; members are taken from the first level
+        size_t levelCalls_;
+    };
+
+} } } // end namespaces
+
+#endif // COLUMNARWRITER_HPP
@@ -0,0 +1,131 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "Compressor.hpp"
+
+// zlib
+#include <zlib.h>
+
+// zstd
+#ifdef HAVE_LIBZSTD
+#include <zstd.h>
+#endif
+
+// std
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+namespace
+{
+    class GzipCompressor : public Compressor
+    {
+    public:
+        GzipCompressor(int level) : level_(level < 0 ? Z_DEFAULT_COMPRESSION : level)
+        {
+            if(level_ > Z_BEST_COMPRESSION)
+                throw runtime_error("output.compress.level for gzip must be 0 to 9");
+        }
+
+        void compress(const char* data, size_t length, std::vector<char>& out) const
+        {
+            z_stream stream = z_stream();
+            // 15 bits window + 16 gives a gzip header and trailer
+            if(deflateInit2(&stream, level_, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK)
+                throw runtime_error("Unable to initialize gzip compression");
+
+            out.resize(deflateBound(&stream, length));
+            stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(data));
+            stream.avail_in = length;
+            stream.next_out = reinterpret_cast<Bytef*>(&out[0]);
+            stream.avail_out = out.size();
+
+            int result = deflate(&stream, Z_FINISH);
+            out.resize(out.size() - stream.avail_out);
+            deflateEnd(&stream);
+            if(result != Z_STREAM_END)
+                throw runtime_error("gzip compression of output failed");
+        }
+
+    private:
+        int level_;
+    };
+
+#ifdef HAVE_LIBZSTD
+    class ZstdCompressor : public Compressor
+    {
+    public:
+        ZstdCompressor(int level) : level_(level < 0 ? 3 : level)
+        {
+            if(level_ > ZSTD_maxCLevel())
+                throw runtime_error("output.compress.level too high for zstd");
+        }
+
+        void compress(const char* data, size_t length, std::vector<char>& out) const
+        {
+            out.resize(ZSTD_compressBound(length));
+            size_t size = ZSTD_compress(&out[0], out.size(), data, length, level_);
+            if(ZSTD_isError(size))
+                throw runtime_error(string("zstd compression of output failed: ") + ZSTD_getErrorName(size));
+            out.resize(size);
+        }
+
+    private:
+        int level_;
+    };
+#endif
+}
+
+    Compressor* Compressor::create(const std::string& method, int level)
+    {
+        if(method.empty() or method == "none") {
+            return 0;
+        } else if(method == "gzip") {
+            return new GzipCompressor(level);
+        } else if(method == "zstd") {
+#ifdef HAVE_LIBZSTD
+            return new ZstdCompressor(level);
+#else
+            throw runtime_error("pointValueLoad was built without zstd support");
+#endif
+        } else {
+            stringstream ss;
+            ss << "Unknown output.compress method: " << method;
+            throw runtime_error(ss.str());
+        }
+    }
+
+} } } // end namespaces
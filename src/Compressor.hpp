@@ -0,0 +1,65 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef COMPRESSOR_HPP
+#define COMPRESSOR_HPP
+
+// boost
+#include <boost/noncopyable.hpp>
+
+// std
+#include <string>
+#include <vector>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Compresses output buffers one at a time (--output.compress).
+      *
+      * Each buffer becomes an independent gzip member or zstd frame.
+      * Concatenated members/frames form a valid stream for gunzip and
+      * unzstd, so buffers may be compressed on several threads at once.
+      */
+    class Compressor : boost::noncopyable
+    {
+    public:
+        virtual ~Compressor() { }
+
+        /// Compress length bytes from data into out (replacing its content); thread safe
+        virtual void compress(const char* data, size_t length, std::vector<char>& out) const = 0;
+
+        /**
+         * Create compressor for method [none/gzip/zstd]; returns 0 for none
+         * @param level compression level; negative means the method's default
+         */
+        static Compressor* create(const std::string& method, int level);
+    };
+
+} } } // end namespaces
+
+#endif // COMPRESSOR_HPP
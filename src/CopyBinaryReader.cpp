@@ -0,0 +1,224 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "CopyBinaryReader.hpp"
+#include "CopyBinaryWriter.hpp"
+#include "FastloadWriter.hpp"
+
+// std
+#include <vector>
+#include <istream>
+#include <ostream>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+    CopyBinaryReader::CopyBinaryReader(std::istream& in) : in_(in) { }
+
+    CopyBinaryReader::~CopyBinaryReader() { }
+
+    size_t CopyBinaryReader::decode(std::ostream& out)
+    {
+        readHeader();
+
+        // only the fields that changed since the previous row are re-rendered
+        string dataProvider;
+        string parameter;
+        string levelName;
+        boost::int64_t referenceTime = 0;
+        boost::int64_t validTime = 0;
+        size_t level = 0;
+        int version = 0;
+        size_t maxVersion = 0;
+        bool first = true;
+        size_t rows = 0;
+
+        for(;;) {
+            boost::int16_t fields = read16();
+            if(fields == -1)
+                break;
+            if(fields != CopyBinaryWriter::columns)
+                throw runtime_error("Unexpected number of columns in binary COPY data");
+
+            double value = readDouble();
+            string wkt = readText();
+            boost::int64_t rt = readTimestamp();
+            boost::int64_t vf = readTimestamp();
+            boost::int64_t vt = readTimestamp();
+            if(vf != vt)
+                throw runtime_error("Binary COPY data with valid time intervals can't be written as point data");
+            string p = readText();
+            string ln = readText();
+            size_t lf = static_cast<size_t>(readDouble());
+            size_t lt = static_cast<size_t>(readDouble());
+            if(lf != lt)
+                throw runtime_error("Binary COPY data with level intervals can't be written as point data");
+            int v = readInt();
+            size_t mv = readInt();
+            string dp = readText();
+
+            if(first || dp != dataProvider) {
+                drain(out);
+                dataProvider = dp;
+                out << FastloadWriter::dataProviderLine(dataProvider);
+            }
+            if(first || rt != referenceTime) {
+                referenceTime = rt;
+                formatter_.setReferenceTime(CopyBinaryWriter::timestamp(rt));
+            }
+            if(first || vf != validTime) {
+                validTime = vf;
+                formatter_.setValidTimes(vector<string>(1, CopyBinaryWriter::timestamp(vf)));
+            }
+            if(first || p != parameter || ln != levelName) {
+                parameter = p;
+                levelName = ln;
+                formatter_.setParameter(parameter, levelName);
+            }
+            if(first || lf != level) {
+                level = lf;
+                formatter_.setLevel(level);
+            }
+            if(first || v != version || mv != maxVersion) {
+                version = v;
+                maxVersion = mv;
+                formatter_.setVersion(version, maxVersion);
+            }
+            first = false;
+
+            formatter_.append(value, wkt, 0);
+            if(formatter_.full())
+                drain(out);
+            ++rows;
+        }
+        drain(out);
+        return rows;
+    }
+
+    void CopyBinaryReader::readHeader()
+    {
+        char signature[sizeof(CopyBinaryWriter::signature)];
+        read(signature, sizeof(signature));
+        if(memcmp(signature, CopyBinaryWriter::signature, sizeof(signature)) != 0)
+            throw runtime_error("Not a binary COPY stream");
+        read32(); // flags
+        boost::int32_t extension = read32();
+        if(extension < 0)
+            throw runtime_error("Corrupt binary COPY header");
+        vector<char> skip(extension + 1);
+        read(&skip[0], extension);
+    }
+
+    void CopyBinaryReader::drain(std::ostream& out)
+    {
+        out.write(formatter_.data(), formatter_.size());
+        formatter_.clear();
+    }
+
+    boost::int16_t CopyBinaryReader::read16()
+    {
+        unsigned char b[2];
+        read(reinterpret_cast<char*>(b), sizeof(b));
+        return static_cast<boost::int16_t>((b[0] << 8) | b[1]);
+    }
+
+    boost::int32_t CopyBinaryReader::read32()
+    {
+        unsigned char b[4];
+        read(reinterpret_cast<char*>(b), sizeof(b));
+        boost::uint32_t v = 0;
+        for(size_t i = 0; i < sizeof(b); ++i)
+            v = (v << 8) | b[i];
+        return static_cast<boost::int32_t>(v);
+    }
+
+    boost::int64_t CopyBinaryReader::read64()
+    {
+        unsigned char b[8];
+        read(reinterpret_cast<char*>(b), sizeof(b));
+        boost::uint64_t v = 0;
+        for(size_t i = 0; i < sizeof(b); ++i)
+            v = (v << 8) | b[i];
+        return static_cast<boost::int64_t>(v);
+    }
+
+    size_t CopyBinaryReader::readLength(size_t size)
+    {
+        boost::int32_t length = read32();
+        if(length < 0)
+            throw runtime_error("Unexpected NULL in binary COPY data");
+        if(size != 0 && static_cast<size_t>(length) != size)
+            throw runtime_error("Unexpected field length in binary COPY data");
+        return length;
+    }
+
+    string CopyBinaryReader::readText()
+    {
+        string value(readLength(), '\0');
+        if(!value.empty())
+            read(&value[0], value.size());
+        return value;
+    }
+
+    double CopyBinaryReader::readDouble()
+    {
+        readLength(sizeof(double));
+        boost::int64_t v = read64();
+        double value;
+        memcpy(&value, &v, sizeof(value));
+        return value;
+    }
+
+    boost::int64_t CopyBinaryReader::readTimestamp()
+    {
+        readLength(sizeof(boost::int64_t));
+        return read64();
+    }
+
+    boost::int32_t CopyBinaryReader::readInt()
+    {
+        readLength(sizeof(boost::int32_t));
+        return read32();
+    }
+
+    void CopyBinaryReader::read(char* data, size_t length)
+    {
+        in_.read(data, length);
+        if(static_cast<size_t>(in_.gcount()) != length)
+            throw runtime_error("Unexpected end of binary COPY data");
+    }
+
+} } } // end namespaces
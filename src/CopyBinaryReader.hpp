@@ -0,0 +1,82 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef COPYBINARYREADER_HPP
+#define COPYBINARYREADER_HPP
+
+// project
+#include "LineFormatter.hpp"
+
+// boost
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+// std
+#include <iosfwd>
+#include <string>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Decodes a binary COPY stream written by CopyBinaryWriter
+      * into wdb-fastload text, without the need for a database server.
+      *
+      * A data provider line is written whenever the provider changes
+      * between rows.
+      */
+    class CopyBinaryReader : boost::noncopyable
+    {
+    public:
+        CopyBinaryReader(std::istream& in);
+        ~CopyBinaryReader();
+
+        /// Decode the whole input stream into out; returns the number of rows
+        size_t decode(std::ostream& out);
+
+    private:
+        void readHeader();
+        void drain(std::ostream& out);
+
+        boost::int16_t read16();
+        boost::int32_t read32();
+        boost::int64_t read64();
+        // read the length of a non-null field, checking it if size is non-zero
+        size_t readLength(size_t size = 0);
+        std::string readText();
+        double readDouble();
+        boost::int64_t readTimestamp();
+        boost::int32_t readInt();
+        void read(char* data, size_t length);
+
+        std::istream& in_;
+        LineFormatter formatter_;
+    };
+
+} } } // end namespaces
+
+#endif // COPYBINARYREADER_HPP
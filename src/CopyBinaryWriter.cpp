@@ -0,0 +1,264 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "CopyBinaryWriter.hpp"
+#include "Loader.hpp"
+
+// boost
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <boost/algorithm/string/replace.hpp>
+#include <boost/numeric/conversion/cast.hpp>
+
+// std
+#include <limits>
+#include <cstring>
+#include <stdexcept>
+
+using namespace std;
+using namespace boost::posix_time;
+
+namespace wdb { namespace load { namespace point {
+
+namespace
+{
+    // network byte order encoding, as required by the COPY format
+
+    void put16(string& out, boost::int16_t value)
+    {
+        boost::uint16_t v = value;
+        out += char(v >> 8);
+        out += char(v);
+    }
+
+    void put32(string& out, boost::int32_t value)
+    {
+        boost::uint32_t v = value;
+        for(int shift = 24; shift >= 0; shift -= 8)
+            out += char(v >> shift);
+    }
+
+    void put64(string& out, boost::int64_t value)
+    {
+        boost::uint64_t v = value;
+        for(int shift = 56; shift >= 0; shift -= 8)
+            out += char(v >> shift);
+    }
+
+    void putDouble(string& out, double value)
+    {
+        boost::int64_t v;
+        memcpy(&v, &value, sizeof(v));
+        put32(out, sizeof(v));
+        put64(out, v);
+    }
+
+    void putText(string& out, const string& value)
+    {
+        put32(out, boost::numeric_cast<boost::int32_t>(value.size()));
+        out += value;
+    }
+
+    void putTimestamp(string& out, const string& time)
+    {
+        put32(out, sizeof(boost::int64_t));
+        put64(out, CopyBinaryWriter::timestamp(time));
+    }
+
+    const ptime postgresEpoch(boost::gregorian::date(2000, 1, 1));
+}
+
+    const boost::int16_t CopyBinaryWriter::columns;
+    const char CopyBinaryWriter::signature[11] = { 'P', 'G', 'C', 'O', 'P', 'Y', '\n', '\377', '\r', '\n', '\0' };
+
+    CopyBinaryWriter::CopyBinaryWriter(Loader& controller, OutputWriter& output) : controller_(controller), output_(output), headerWritten_(false), fields_(*this)
+    {
+        buffer_.reserve((1 << 16) + 1024);
+    }
+
+    CopyBinaryWriter::CopyBinaryWriter(const CopyBinaryWriter& parent, boost::shared_ptr<BlockOutput> block)
+        : controller_(parent.controller_), output_(block->writer()), headerWritten_(true), dataProvider_(parent.dataProvider_),
+          fields_(parent), block_(block)
+    {
+        buffer_.reserve((1 << 16) + 1024);
+    }
+
+    CopyBinaryWriter::~CopyBinaryWriter() { }
+
+    void CopyBinaryWriter::beginEntries(const string& referenceTime, const vector<string>& validTimes)
+    {
+        writeHeader();
+
+        const vector<string>& wkts = controller_.wkts();
+        if(wkts_.size() != wkts.size()) {
+            wkts_.resize(wkts.size());
+            for(size_t i = 0; i < wkts.size(); ++i) {
+                wkts_[i].clear();
+                putText(wkts_[i], wkts[i]);
+            }
+        }
+
+        referenceTime_.clear();
+        putTimestamp(referenceTime_, referenceTime);
+
+        // valid from and valid to are the same
+        validTimes_.resize(validTimes.size());
+        for(size_t u = 0; u < validTimes.size(); ++u) {
+            validTimes_[u].clear();
+            putTimestamp(validTimes_[u], validTimes[u]);
+            validTimes_[u] += validTimes_[u];
+        }
+
+        dataProvider_.clear();
+    }
+
+    void CopyBinaryWriter::beginEntry(const string& dataProvider, const string& parameter, const string& levelName)
+    {
+        if(dataProvider_ != dataProvider) {
+            drain();
+            if(!dataProvider_.empty())
+                output_.flush(OutputWriter::FlushDataProvider);
+            dataProvider_ = dataProvider;
+            provider_.clear();
+            putText(provider_, dataProvider_);
+        }
+        parameter_.clear();
+        putText(parameter_, parameter);
+        putText(parameter_, levelName);
+    }
+
+    void CopyBinaryWriter::setLevel(size_t level)
+    {
+        level_.clear();
+        putDouble(level_, level);
+        putDouble(level_, level);
+    }
+
+    void CopyBinaryWriter::setVersion(int version, size_t maxVersion)
+    {
+        version_.clear();
+        put32(version_, sizeof(boost::int32_t));
+        put32(version_, version);
+        put32(version_, sizeof(boost::int32_t));
+        put32(version_, boost::numeric_cast<boost::int32_t>(maxVersion));
+    }
+
+    void CopyBinaryWriter::write(double value, size_t station, size_t time)
+    {
+        put16(buffer_, columns);
+        putDouble(buffer_, value);
+        buffer_ += fields_.wkts_[station];
+        buffer_ += fields_.referenceTime_;
+        buffer_ += fields_.validTimes_[time];
+        buffer_ += fields_.parameter_;
+        buffer_ += level_;
+        buffer_ += version_;
+        buffer_ += fields_.provider_;
+
+        if(buffer_.size() >= (1 << 16))
+            drain();
+    }
+
+    void CopyBinaryWriter::endEntries()
+    {
+        drain();
+        if(!dataProvider_.empty())
+            output_.flush(OutputWriter::FlushDataProvider);
+    }
+
+    void CopyBinaryWriter::close()
+    {
+        writeHeader();
+        drain();
+        string trailer;
+        put16(trailer, -1);
+        output_.write(trailer);
+    }
+
+    PointWriter* CopyBinaryWriter::fork()
+    {
+        return new CopyBinaryWriter(*this, boost::shared_ptr<BlockOutput>(new BlockOutput));
+    }
+
+    void CopyBinaryWriter::join(PointWriter& block)
+    {
+        CopyBinaryWriter& rows = static_cast<CopyBinaryWriter&>(block);
+        rows.drain();
+        drain();
+        output_.write(rows.block_->take());
+    }
+
+    void CopyBinaryWriter::writeHeader()
+    {
+        if(headerWritten_)
+            return;
+        string header(signature, sizeof(signature));
+        put32(header, 0); // flags
+        put32(header, 0); // header extension length
+        output_.write(header);
+        headerWritten_ = true;
+    }
+
+    void CopyBinaryWriter::drain()
+    {
+        if(buffer_.empty())
+            return;
+        output_.write(buffer_);
+        buffer_.clear();
+    }
+
+    boost::int64_t CopyBinaryWriter::timestamp(const string& time)
+    {
+        if(time == "infinity")
+            return numeric_limits<boost::int64_t>::max();
+        if(time == "-infinity")
+            return numeric_limits<boost::int64_t>::min();
+
+        // the loaders write zulu time as YYYY-MM-DDThh:mm:ss+00
+        string t = time;
+        if(t.size() > 3 && t.compare(t.size() - 3, 3, "+00") == 0)
+            t.erase(t.size() - 3);
+        boost::algorithm::replace_first(t, "T", " ");
+        return (time_from_string(t) - postgresEpoch).total_microseconds();
+    }
+
+    string CopyBinaryWriter::timestamp(boost::int64_t time)
+    {
+        if(time == numeric_limits<boost::int64_t>::max())
+            return "infinity";
+        if(time == numeric_limits<boost::int64_t>::min())
+            return "-infinity";
+        ptime t = postgresEpoch + seconds(time / 1000000) + microseconds(time % 1000000);
+        return to_iso_extended_string(t) + "+00";
+    }
+
+} } } // end namespaces
@@ -0,0 +1,124 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef COPYBINARYWRITER_HPP
+#define COPYBINARYWRITER_HPP
+
+// project
+#include "PointWriter.hpp"
+
+// boost
+#include <boost/cstdint.hpp>
+#include <boost/shared_ptr.hpp>
+
+// std
+#include <string>
+#include <vector>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Writes a PostgreSQL binary COPY stream (--output.format=copy),
+      * to be loaded with COPY ... FROM STDIN (FORMAT binary) into a
+      * table with these columns:
+      *
+      *  value              float8
+      *  placegeometry      text (WKT)
+      *  referencetime      timestamptz
+      *  validtimefrom      timestamptz
+      *  validtimeto        timestamptz
+      *  valueparametername text
+      *  levelparametername text
+      *  levelfrom          float8
+      *  levelto            float8
+      *  dataversion        int4
+      *  maxdataversion     int4
+      *  dataprovidername   text
+      *
+      * Timestamps use the server's default integer datetime encoding.
+      * All fields but the value are encoded once and copied into each row.
+      */
+    class CopyBinaryWriter : public PointWriter
+    {
+    public:
+        CopyBinaryWriter(Loader& controller, OutputWriter& output);
+        ~CopyBinaryWriter();
+
+        void beginEntries(const std::string& referenceTime, const std::vector<std::string>& validTimes);
+        void beginEntry(const std::string& dataProvider, const std::string& parameter, const std::string& levelName);
+        void setLevel(size_t level);
+        void setVersion(int version, size_t maxVersion);
+        void write(double value, size_t station, size_t time);
+        void endEntries();
+        void close();
+        PointWriter* fork();
+        void join(PointWriter& block);
+
+        /// Number of columns in each row
+        static const boost::int16_t columns = 12;
+        /// The fixed start of every binary COPY stream
+        static const char signature[11];
+
+        /// Microseconds since 2000-01-01 00:00:00+00 for the times written by the loaders
+        static boost::int64_t timestamp(const std::string& time);
+        /// Inverse of timestamp()
+        static std::string timestamp(boost::int64_t time);
+
+    private:
+        // block of the parent's current entry (see fork)
+        CopyBinaryWriter(const CopyBinaryWriter& parent, boost::shared_ptr<BlockOutput> block);
+
+        void writeHeader();
+        // hand encoded rows to the output
+        void drain();
+
+        Loader& controller_;
+        OutputWriter& output_;
+        bool headerWritten_;
+        std::string dataProvider_;
+        std::string buffer_;
+
+        // fields encoded with their length prefix
+        std::vector<std::string> wkts_;
+        std::vector<std::string> validTimes_;
+        std::string referenceTime_;
+        std::string parameter_;     // valueparametername, levelparametername
+        std::string level_;         // levelfrom, levelto
+        std::string version_;       // dataversion, maxdataversion
+        std::string provider_;      // dataprovidername
+
+        // the writer holding the per file and per entry fields; *this but for blocks
+        const CopyBinaryWriter& fields_;
+
+        // memory behind output_ for a block
+        boost::shared_ptr<BlockOutput> block_;
+    };
+
+} } } // end namespaces
+
+#endif // COPYBINARYWRITER_HPP
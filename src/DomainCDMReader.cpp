@@ -0,0 +1,137 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "DomainCDMReader.hpp"
+
+// libfimex
+#include <fimex/CDM.h>
+#include <fimex/Data.h>
+
+// boost
+#include <boost/lexical_cast.hpp>
+
+// std
+#include <iomanip>
+#include <sstream>
+
+using namespace std;
+using namespace MetNoFimex;
+
+namespace wdb { namespace load { namespace point {
+
+    DomainCDMReader::DomainCDMReader(boost::shared_ptr<CDMReader> dataReader)
+        : dataReader_(dataReader)
+    {
+        cdm_ = boost::shared_ptr<CDM>(new CDM(dataReader_->getCDM()));
+
+        map<pair<string, string>, string> byAxes;
+        const vector<CDMVariable> variables = cdm_->getVariables();
+        for(size_t i = 0; i < variables.size(); ++i) {
+            const string& name = variables[i].getName();
+            string x = cdm_->getHorizontalXAxis(name);
+            string y = cdm_->getHorizontalYAxis(name);
+            if(x.empty() || y.empty() || name == x || name == y)
+                continue;
+
+            pair<string, string> axes(x, y);
+            map<pair<string, string>, string>::const_iterator found = byAxes.find(axes);
+            if(found != byAxes.end()) {
+                domains_[name] = found->second;
+                continue;
+            }
+
+            string domain = "pointload_domain_" + boost::lexical_cast<string>(grids_.size());
+            vector<string> shape;
+            shape.push_back(x);
+            shape.push_back(y);
+            cdm_->addVariable(CDMVariable(domain, CDM_DOUBLE, shape));
+
+            // the grid extent in its own coordinates, and its projection
+            stringstream key;
+            key << setprecision(17);
+            for(size_t a = 0; a < shape.size(); ++a) {
+                const size_t length = cdm_->getDimension(shape[a]).getLength();
+                key << shape[a] << "[" << length;
+                if(length > 0 && cdm_->hasVariable(shape[a])) {
+                    boost::shared_array<double> values = dataReader_->getData(shape[a])->asDouble();
+                    key << " " << values[0] << " " << values[length - 1];
+                }
+                key << "] ";
+            }
+            CDMAttribute attribute;
+            if(cdm_->getAttribute(name, "coordinates", attribute))
+                cdm_->addAttribute(domain, attribute);
+            if(cdm_->getAttribute(name, "grid_mapping", attribute)) {
+                cdm_->addAttribute(domain, attribute);
+                key << attribute.getStringValue();
+                CDMAttribute proj4;
+                if(cdm_->getAttribute(attribute.getStringValue(), "proj4", proj4))
+                    key << " " << proj4.getStringValue();
+            }
+
+            Grid grid = { x, y, key.str() };
+            grids_[domain] = grid;
+            byAxes[axes] = domain;
+            domains_[name] = domain;
+        }
+    }
+
+    DomainCDMReader::~DomainCDMReader() { }
+
+    string DomainCDMReader::domainOf(const string& varName) const
+    {
+        map<string, string>::const_iterator found = domains_.find(varName);
+        return found == domains_.end() ? string() : found->second;
+    }
+
+    string DomainCDMReader::gridKey(const string& domainName) const
+    {
+        map<string, Grid>::const_iterator found = grids_.find(domainName);
+        return found == grids_.end() ? string() : found->second.key;
+    }
+
+    boost::shared_ptr<Data> DomainCDMReader::getDataSlice(const string& varName, size_t unLimDimPos)
+    {
+        map<string, Grid>::const_iterator found = grids_.find(varName);
+        if(found == grids_.end())
+            return dataReader_->getDataSlice(varName, unLimDimPos);
+
+        const Grid& grid = found->second;
+        size_t size = cdm_->getDimension(grid.x).getLength() * cdm_->getDimension(grid.y).getLength();
+        boost::shared_array<double> values(new double[size]);
+        for(size_t i = 0; i < size; ++i)
+            values[i] = 1;
+        return createData(size, values);
+    }
+
+} } } // end namespaces
@@ -0,0 +1,83 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef DOMAINCDMREADER_HPP
+#define DOMAINCDMREADER_HPP
+
+// libfimex
+#include <fimex/CDMReader.h>
+
+// boost
+#include <boost/shared_ptr.hpp>
+
+// std
+#include <map>
+#include <string>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Marks the area covered by each horizontal grid of a CDMReader.
+      *
+      * For every distinct pair of horizontal axes a variable pointload_domain_N
+      * (x, y) is added, 1 everywhere on the grid. Interpolated to the station
+      * template it is NaN exactly for the stations the interpolator can't
+      * reach, so FileLoader can drop them before extracting any parameter.
+      * All other variables are passed through unchanged.
+      */
+    class DomainCDMReader : public MetNoFimex::CDMReader
+    {
+    public:
+        explicit DomainCDMReader(boost::shared_ptr<MetNoFimex::CDMReader> dataReader);
+        ~DomainCDMReader();
+
+        using MetNoFimex::CDMReader::getDataSlice;
+        boost::shared_ptr<MetNoFimex::Data> getDataSlice(const std::string& varName, size_t unLimDimPos);
+
+        /// The domain variable of the grid varName is on, empty if it has no horizontal axes
+        std::string domainOf(const std::string& varName) const;
+
+        /// Identifies the grid of a domain variable (axes, their extent and grid mapping), for caching
+        std::string gridKey(const std::string& domainName) const;
+
+    private:
+        struct Grid
+        {
+            std::string x;
+            std::string y;
+            std::string key;
+        };
+
+        boost::shared_ptr<MetNoFimex::CDMReader> dataReader_;
+        std::map<std::string, Grid> grids_;             // domain variable -> grid
+        std::map<std::string, std::string> domains_;    // data variable -> domain variable
+    };
+
+} } } // end namespaces
+
+#endif // DOMAINCDMREADER_HPP
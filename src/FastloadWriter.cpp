@@ -0,0 +1,112 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "FastloadWriter.hpp"
+#include "Loader.hpp"
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+    FastloadWriter::FastloadWriter(Loader& controller, OutputWriter& output) : controller_(controller), output_(output), wkts_(0) { }
+
+    FastloadWriter::FastloadWriter(const FastloadWriter& parent, boost::shared_ptr<BlockOutput> block)
+        : controller_(parent.controller_), output_(block->writer()), wkts_(parent.wkts_), dataProvider_(parent.dataProvider_), block_(block)
+    {
+        formatter_.setReferenceTime(parent.referenceTime_);
+        formatter_.setValidTimes(parent.validTimes_);
+        formatter_.setParameter(parent.parameter_, parent.levelName_);
+    }
+
+    FastloadWriter::~FastloadWriter() { }
+
+    void FastloadWriter::beginEntries(const string& referenceTime, const vector<string>& validTimes)
+    {
+        wkts_ = &controller_.wkts();
+        dataProvider_.clear();
+        formatter_.clear();
+        formatter_.setReferenceTime(referenceTime);
+        formatter_.setValidTimes(validTimes);
+        referenceTime_ = referenceTime;
+        validTimes_ = validTimes;
+    }
+
+    // write data provider on a separate line (required by wdb-fastload format)
+    void FastloadWriter::beginEntry(const string& dataProvider, const string& parameter, const string& levelName)
+    {
+        if(dataProvider_ != dataProvider) {
+            drain();
+            if(!dataProvider_.empty())
+                output_.flush(OutputWriter::FlushDataProvider);
+            dataProvider_ = dataProvider;
+            output_.write(dataProviderLine(dataProvider_));
+        }
+        formatter_.setParameter(parameter, levelName);
+        parameter_ = parameter;
+        levelName_ = levelName;
+    }
+
+    void FastloadWriter::endEntries()
+    {
+        drain();
+        if(!dataProvider_.empty())
+            output_.flush(OutputWriter::FlushDataProvider);
+    }
+
+    PointWriter* FastloadWriter::fork()
+    {
+        return new FastloadWriter(*this, boost::shared_ptr<BlockOutput>(new BlockOutput));
+    }
+
+    void FastloadWriter::join(PointWriter& block)
+    {
+        FastloadWriter& lines = static_cast<FastloadWriter&>(block);
+        lines.drain();
+        drain();
+        output_.write(lines.block_->take());
+    }
+
+    string FastloadWriter::dataProviderLine(const string& dataProvider)
+    {
+        return "\n" + dataProvider + "\t88,0,88\n";
+    }
+
+    void FastloadWriter::drain()
+    {
+        if(formatter_.empty())
+            return;
+        output_.write(formatter_.data(), formatter_.size());
+        formatter_.clear();
+    }
+
+} } } // end namespaces
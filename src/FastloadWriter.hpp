@@ -0,0 +1,97 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef FASTLOADWRITER_HPP
+#define FASTLOADWRITER_HPP
+
+// project
+#include "PointWriter.hpp"
+#include "LineFormatter.hpp"
+
+// boost
+#include <boost/shared_ptr.hpp>
+
+// std
+#include <string>
+#include <vector>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Writes the text format read by wdb-fastload: a data provider line
+      * whenever the provider changes, followed by one line per value.
+      */
+    class FastloadWriter : public PointWriter
+    {
+    public:
+        FastloadWriter(Loader& controller, OutputWriter& output);
+        ~FastloadWriter();
+
+        void beginEntries(const std::string& referenceTime, const std::vector<std::string>& validTimes);
+        void beginEntry(const std::string& dataProvider, const std::string& parameter, const std::string& levelName);
+        void setLevel(size_t level) { formatter_.setLevel(level); }
+        void setVersion(int version, size_t maxVersion) { formatter_.setVersion(version, maxVersion); }
+        void write(double value, size_t station, size_t time)
+        {
+            formatter_.append(value, (*wkts_)[station], time);
+            if(formatter_.full())
+                drain();
+        }
+        void endEntries();
+        PointWriter* fork();
+        void join(PointWriter& block);
+
+        /// The line written before the values of each data provider
+        static std::string dataProviderLine(const std::string& dataProvider);
+
+    private:
+        // block of the parent's current entry (see fork)
+        FastloadWriter(const FastloadWriter& parent, boost::shared_ptr<BlockOutput> block);
+
+        // hand formatted lines to the output
+        void drain();
+
+        Loader& controller_;
+        OutputWriter& output_;
+        const std::vector<std::string>* wkts_;
+        LineFormatter formatter_;
+        std::string dataProvider_;
+
+        // kept for fork
+        std::string referenceTime_;
+        std::vector<std::string> validTimes_;
+        std::string parameter_;
+        std::string levelName_;
+
+        // memory behind output_ for a block
+        boost::shared_ptr<BlockOutput> block_;
+    };
+
+} } } // end namespaces
+
+#endif // FASTLOADWRITER_HPP
@@ -126,15 +126,12 @@ namespace wdb { namespace load { namespace point {
 
     // create the lost of EntryToLoad items for parameters to be load
     // config files are describing how should felt params be mapped to wdb
-    void FeltLoader::loadInterpolated(const string& fileName)
+    void FeltLoader::findEntries(const string& fileName)
     {
         WDB_LOG & log = WDB_LOG::getInstance( "wdb.pointLoad.FeltLoader" );
 
         felt::FeltFile file(fileName);
 
-        if(times_.size() == 0)
-            return;
-
         for(felt::FeltFile::const_iterator it = file.begin(); it != file.end(); ++it)
         {
             try{
@@ -170,13 +167,6 @@ namespace wdb { namespace load { namespace point {
                 log.errorStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "] " << e.what() << " Data field not loaded.";
             }
         }
-
-        // create data lines for selected params
-        // follow wdb-fastload format
-        loadEntries();
-
-        // same sa abpve but for wind_direction and wind_speed
-        loadWindEntries();
     }
 
     std::string FeltLoader::dataProviderName(const felt::FeltField & field)
@@ -80,7 +80,7 @@ namespace wdb { namespace load { namespace point {
 
         // Make a list (EntryToLoad) of parameters to be loaded
         // The config files are describing the params
-        void loadInterpolated(const string& fileName);
+        void findEntries(const string& fileName);
 
         // read the metadata mapping for the felt params
         std::string dataProviderName(const felt::FeltField& field);
@@ -35,6 +35,11 @@
 #include "FeltLoader.hpp"
 #include "GribLoader.hpp"
 #include "NetCDFLoader.hpp"
+#include "PointWriter.hpp"
+#include "WindCDMReader.hpp"
+#include "DomainCDMReader.hpp"
+#include "CDMIndex.hpp"
+#include "SlabPrefetcher.hpp"
 
 // libfimex
 #include <fimex/CDM.h>
@@ -47,12 +52,15 @@
 #include <fimex/CDMReaderUtils.h>
 #include <fimex/CDMInterpolator.h>
 #include <fimex/CDMFileReaderFactory.h>
+#include <fimex/NetCDF_CDMWriter.h>
+#include <fimex/SliceBuilder.h>
 
 // wdb
 #include <wdbException.h>
 #include <wdbLogHandler.h>
 
 // boost
+#include <boost/bind.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/date_time/posix_time/posix_time_types.hpp>
 #include <boost/filesystem.hpp>
@@ -61,13 +69,16 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 
+// std
+#include <fstream>
+#include <sstream>
+#include <unistd.h>
+
 using namespace std;
 using namespace boost::posix_time;
 using namespace boost::filesystem;
 using namespace MetNoFimex;
 
-#define PI 3.14159265
-
 namespace {
 
     path getConfigFile(const path& fileName)
@@ -87,14 +98,62 @@ namespace {
         string ret = to_iso_extended_string(time) + "+00";
         return ret;
     }
+
+    // the values of data as an array of T (double or float)
+    boost::shared_array<double> asArray(const Data& data, double) { return data.asDouble(); }
+    boost::shared_array<float> asArray(const Data& data, float) { return data.asFloat(); }
+
+    // index of a wdb level on a vertical axis of length values (whole
+    // levels are compared); the first level when it is not there
+    size_t levelIndex(const boost::shared_array<double>& axis, size_t length, size_t wdbLevel)
+    {
+        for(size_t index = 0; axis && index < length; ++index) {
+            if(wdbLevel == axis[index])
+                return index;
+        }
+        return 0;
+    }
+
+    // resident set size of the process, 0 where /proc is not there
+    size_t residentBytes()
+    {
+        std::ifstream statm("/proc/self/statm");
+        size_t pages = 0;
+        size_t resident = 0;
+        if(!(statm >> pages >> resident))
+            return 0;
+        return resident * sysconf(_SC_PAGESIZE);
+    }
+
+    // peak resident set size of the process so far (VmHWM), 0 where /proc is not there
+    size_t highWaterBytes()
+    {
+        std::ifstream status("/proc/self/status");
+        string line;
+        while(std::getline(status, line)) {
+            if(line.compare(0, 6, "VmHWM:") != 0)
+                continue;
+            std::istringstream kib(line.substr(6));
+            size_t value = 0;
+            if(!(kib >> value))
+                return 0;
+            return value << 10;
+        }
+        return 0;
+    }
 }
 
 namespace wdb { namespace load { namespace point {
 
-    FileLoader::FileLoader(Loader& controller) : controller_(controller) { }
+    FileLoader::FileLoader(Loader& controller) : controller_(controller), readCachePeakBytes_(0), slabReadBytes_(0), peakBytes_(0), sliceReads_(0), repeatedSliceReads_(0) { }
 
     FileLoader::~FileLoader() { }
 
+    template<> StagedEntry& FileLoader::staged<double>() { return staged_; }
+    template<> StagedEntryFloat& FileLoader::staged<float>() { return stagedFloat_; }
+    template<> ReadCache<double>& FileLoader::readCache<double>() { return readCache_; }
+    template<> ReadCache<float>& FileLoader::readCache<float>() { return readCacheFloat_; }
+
     void FileLoader::setup()
     {
         // check for excess parameters
@@ -153,6 +212,22 @@ namespace wdb { namespace load { namespace point {
         if(not cdmData_.get())
             return false;
 
+        // only the span of the levels the entries ask for is decoded and
+        // interpolated, the levels out of it are dropped by an extractor
+        const map<string, pair<size_t, size_t> > spans = levelSpans();
+        if(!spans.empty()) {
+            boost::shared_ptr<CDMExtractor> extractor(new CDMExtractor(cdmData_));
+            for(map<string, pair<size_t, size_t> >::const_iterator span = spans.begin(); span != spans.end(); ++span) {
+                extractor->reduceDimension(span->first, span->second.first, span->second.second);
+                // the axis read for the entries is cut likewise
+                const boost::shared_array<double> axis = levelAxis(span->first);
+                boost::shared_array<double> reduced(new double[span->second.second]);
+                copy(axis.get() + span->second.first, axis.get() + span->second.first + span->second.second, reduced.get());
+                levelAxes_[span->first] = reduced;
+            }
+            cdmData_ = extractor;
+        }
+
         boost::shared_ptr<CDMInterpolator> interpolator = boost::shared_ptr<CDMInterpolator>(new CDMInterpolator(cdmData_));
 
         // interpolate in specific geographical (lat/lon) points
@@ -165,6 +240,72 @@ namespace wdb { namespace load { namespace point {
         return true;
     }
 
+    map<string, pair<size_t, size_t> > FileLoader::levelSpans()
+    {
+        WDB_LOG & log = WDB_LOG::getInstance( "wdb.pointLoad.FileLoader" );
+
+        // the variables of the entries are looked up as in loadEntries, the
+        // wind components being among the entries until loadWindEntries
+        map<string, set<size_t> > requested;
+        for(map<string, EntryToLoad>::const_iterator it = entries2load().begin(); it != entries2load().end(); ++it) {
+            const EntryToLoad& entry(it->second);
+            const CDMIndex::Variable* variable = 0;
+            if(!entry.cdmName_.empty()) {
+                variable = index_.variable(entry.cdmName_);
+            } else {
+                string standardName(entry.standardName_);
+                boost::algorithm::replace_all(standardName, " ", "_");
+                const vector<const CDMIndex::Variable*>& variables = index_.withStandardName(standardName);
+                if(variables.size() == 1)
+                    variable = variables[0];
+            }
+            if(variable == 0 || variable->verticalAxis.empty() || entry.wdbLevels_.empty())
+                continue;
+            const boost::shared_array<double>& axis = levelAxis(variable->verticalAxis);
+            const size_t length = index_.dimensionLength(variable->verticalAxis);
+            for(set<double>::const_iterator level = entry.wdbLevels_.begin(); level != entry.wdbLevels_.end(); ++level)
+                requested[variable->verticalAxis].insert(levelIndex(axis, length, *level));
+        }
+
+        map<string, pair<size_t, size_t> > spans;
+        for(map<string, set<size_t> >::const_iterator it = requested.begin(); it != requested.end(); ++it) {
+            const size_t first = *it->second.begin();
+            const size_t count = *it->second.rbegin() - first + 1;
+            if(count == index_.dimensionLength(it->first))
+                continue;
+            spans[it->first] = make_pair(first, count);
+            log.debugStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "]" << " levels " << first << " to " << first + count - 1 << " of " << it->first;
+        }
+        return spans;
+    }
+
+    const boost::shared_array<double>& FileLoader::levelAxis(const string& name)
+    {
+        boost::shared_array<double>& axis = levelAxes_[name];
+        if(!axis) {
+            axis = cdmData_->getData(name)->asDouble();
+            ++levelAxisReads_[name];
+        }
+        return axis;
+    }
+
+    // add a domain variable for each grid (see DomainCDMReader)
+    // to be interpolated together with the data
+    bool FileLoader::markDomainCDM()
+    {
+        domain_.reset();
+
+        if(options().loading().fimexTemplate.empty())
+            return false;
+        if(not cdmData_.get())
+            return false;
+
+        domain_ = boost::shared_ptr<DomainCDMReader>(new DomainCDMReader(cdmData_));
+        cdmData_ = domain_;
+
+        return true;
+    }
+
     // extract time axis - used to set valid from & valid to times
     bool FileLoader::timeFromCDM()
     {
@@ -233,11 +374,37 @@ namespace wdb { namespace load { namespace point {
         return true;
     }
 
+    void FileLoader::resetFile()
+    {
+        entries2load().clear();
+        times_.clear();
+        uwinds().clear();
+        vwinds().clear();
+        cdmData_.reset();
+        domain_.reset();
+        index_.clear();
+        staged_.release();
+        stagedFloat_.release();
+        readCache_.clear();
+        readCacheFloat_.clear();
+        levelAxes_.clear();
+    }
+
     /*
      * Describes steps used to extract point data
      **/
     void FileLoader::load(const string& fileName)
     {
+        WDB_LOG & log = WDB_LOG::getInstance( "wdb.pointLoad.FileLoader" );
+
+        // nothing of the previous file is kept; the peak is
+        // kept past the second reset below, to be reported
+        resetFile();
+        peakBytes_ = 0;
+        sliceReads_ = 0;
+        repeatedSliceReads_ = 0;
+        const size_t residentBefore = residentBytes();
+
         // create CDMReader for the input file
         // some fule types need fimex reader xml config file
         openCDM(fileName);
@@ -246,18 +413,93 @@ namespace wdb { namespace load { namespace point {
         // to recalculate wind_speed and wind_direction
         processCDM();
 
-        // use fimex and template interpolation to
-        // interpolase CDMReader in wanted points
-        interpolateCDM();
-
+        // mark the area of each grid, to find
+        // the stations outside it once interpolated
+        markDomainCDM();
 
         // extract time axis values
         timeFromCDM();
 
+        // index the variables metadata of the grids
+        index_.build(cdmData_->getCDM());
+
         // read input file and check config files
         // to determine what parameters are to
         // be loaded and how are the mapped in wdb
-        loadInterpolated(fileName);
+        if(!times_.empty())
+            findEntries(fileName);
+
+        // use fimex and template interpolation to
+        // interpolase CDMReader in wanted points,
+        // at the levels of the entries found
+        interpolateCDM();
+
+        // index the interpolated variables
+        // for the lookups of the loaders
+        index_.build(cdmData_->getCDM());
+
+        // create data lines for selected params, then
+        // for wind_direction and wind_speed
+        if(!times_.empty()) {
+            loadEntries();
+            loadWindEntries();
+        }
+
+        // the readers, entries and buffers of the file are freed
+        // once it is written, so that long runs stay flat
+        resetFile();
+        const size_t residentAfter = residentBytes();
+        if(residentBefore > 0 && residentAfter > 0)
+            log.infoStream() << fileName << ": resident memory " << (residentAfter >> 20) << " MiB ("
+                             << (residentAfter >= residentBefore ? "+" : "-")
+                             << ((residentAfter >= residentBefore ? residentAfter - residentBefore : residentBefore - residentAfter) >> 10) << " KiB for the file)";
+
+        // each read through the interpolator decodes and interpolates its
+        // time steps for the whole grid, again for every further slab
+        log.infoStream() << fileName << ": " << sliceReads_ << " time slices decoded and interpolated, "
+                         << repeatedSliceReads_ << " of them again for further slabs";
+
+        // report the memory used by the slabs against the budget; the
+        // slab peak is estimated from the sizes read, staged, read ahead
+        // and shared, the high-water mark is measured for the process
+        const size_t memoryLimit = options().loading().memoryLimit << 20;
+        const size_t highWater = highWaterBytes();
+        std::ostringstream measured;
+        if(highWater > 0)
+            measured << ", process high-water mark " << (highWater >> 20) << " MiB";
+        if(memoryLimit > 0 && peakBytes_ > memoryLimit)
+            log.warnStream() << fileName << ": estimated peak slab memory " << (peakBytes_ >> 20) << " MiB exceeds memory.limit of " << options().loading().memoryLimit << " MiB (a slab is at least one grid row)" << measured.str();
+        else if(memoryLimit > 0)
+            log.infoStream() << fileName << ": estimated peak slab memory " << (peakBytes_ >> 20) << " MiB of memory.limit " << options().loading().memoryLimit << " MiB" << measured.str();
+        else
+            log.infoStream() << fileName << ": estimated peak slab memory " << (peakBytes_ >> 20) << " MiB" << measured.str();
+    }
+
+    /*
+     * Writes the interpolated data, with wind speed and direction
+     * when wind components are rotated, as a station NetCDF file
+     **/
+    void FileLoader::writeNetCDF(const string& fileName, const string& outFileName)
+    {
+        WDB_LOG & log = WDB_LOG::getInstance( "wdb.pointLoad.FileLoader" );
+
+        resetFile();
+
+        openCDM(fileName);
+
+        processCDM();
+
+        if(!interpolateCDM())
+            throw runtime_error("Unable to interpolate " + fileName + " (is fimex.interpolate.template given?)");
+
+        boost::shared_ptr<CDMReader> stations = cdmData_;
+        if(!uwinds().empty())
+            stations = boost::shared_ptr<CDMReader>(new WindCDMReader(cdmData_, uwinds(), vwinds()));
+
+        // the writer does all the work in its constructor
+        NetCDF_CDMWriter writer(stations, outFileName);
+
+        log.infoStream() << "Wrote " << fileName << " as " << outFileName;
     }
 
     /*
@@ -279,14 +521,13 @@ namespace wdb { namespace load { namespace point {
         map<string, EntryToLoad> winds;
 
         for(size_t i = 0; i < uwinds().size(); ++i) {
-            CDMAttribute uAtt;
-            cdmData_->getCDM().getAttribute(uwinds()[i], "standard_name", uAtt);
-            string ucfname = uAtt.getStringValue();
+            const CDMIndex::Variable* uVariable = index_.variable(uwinds()[i]);
+            const CDMIndex::Variable* vVariable = index_.variable(vwinds()[i]);
+
+            string ucfname = uVariable ? uVariable->standardName : string();
             boost::algorithm::replace_all(ucfname, "_", " ");
 
-            CDMAttribute vAtt;
-            cdmData_->getCDM().getAttribute(vwinds()[i], "standard_name", vAtt);
-            string vcfname = vAtt.getStringValue();
+            string vcfname = vVariable ? vVariable->standardName : string();
             boost::algorithm::replace_all(vcfname, "_", " ");
 
             if(entries2load().find(ucfname) == entries2load().end())
@@ -294,8 +535,8 @@ namespace wdb { namespace load { namespace point {
             if(entries2load().find(vcfname) == entries2load().end())
                 throw runtime_error("can't find v wind entry");
 
-            EntryToLoad uEntry = entries2load()[ucfname];
-            EntryToLoad vEntry = entries2load()[vcfname];
+            const EntryToLoad& uEntry = entries2load()[ucfname];
+            const EntryToLoad& vEntry = entries2load()[vcfname];
 
             if(uEntry.wdbUnit_ != vEntry.wdbUnit_)
                 throw runtime_error("units for wind componenets don't match");
@@ -315,27 +556,13 @@ namespace wdb { namespace load { namespace point {
                 throw runtime_error("levels for wind componenets don't match");
             set<double> levels(uEntry.wdbLevels_);
 
-            string xName = cdmData_->getCDM().getHorizontalXAxis(uwinds()[i]);
-            string yName = cdmData_->getCDM().getHorizontalYAxis(uwinds()[i]);
-            size_t xDimLength = cdmData_->getCDM().getDimension(xName).getLength();
-            size_t yDimLength = cdmData_->getCDM().getDimension(yName).getLength();
-
-            const CDMVariable& uVariabe = cdmData_->getCDM().getVariable(uwinds()[i]);
-            vector<string> shape(uVariabe.getShape().begin(), uVariabe.getShape().end());
-            string lDimName = cdmData_->getCDM().getVerticalAxis(uwinds()[i]);
-
-            boost::shared_ptr<Data> udata = cdmData_->getScaledDataInUnit(uwinds()[i], wdbunit);
-            boost::shared_ptr<Data> vdata = cdmData_->getScaledDataInUnit(vwinds()[i], wdbunit);
-            boost::shared_array<double> uwinddata = udata->asDouble();
-            boost::shared_array<double> vwinddata = vdata->asDouble();
+            size_t xDimLength = uVariable->xLength;
+            size_t yDimLength = uVariable->yLength;
+            const vector<string>& shape = uVariable->shape;
+            string lDimName = uVariable->verticalAxis;
 
-            size_t utds = udata->size();
-            size_t vtds = vdata->size();
-            if(utds != vtds)
-                throw runtime_error("datasizes for wind componenets don't match");
-            size_t tds = utds;
-
-            EntryToLoad speed;
+            // built in place in the map of wind entries
+            EntryToLoad& speed = winds["wind speed" + boost::lexical_cast<string>(i)];
             speed.wdbName_ = "wind speed";
             speed.cdmName_ = "wind_speed";
             speed.standardName_ = "wind_speed";
@@ -343,13 +570,18 @@ namespace wdb { namespace load { namespace point {
             speed.wdbDataProvider_ = wdbdataprovider;
             speed.wdbLevelName_ = levelname;
             speed.wdbLevels_ = levels;
-            speed.cdmData_ = boost::shared_array<double>(new double[tds]);
             speed.cdmShape_ = shape;
             speed.cdmLevelName_ = lDimName;
+            speed.cdmXName_ = uVariable->xAxis;
+            speed.cdmYName_ = uVariable->yAxis;
             speed.cdmXDimLength_ = xDimLength;
             speed.cdmYDimLength_ = yDimLength;
+            speed.cdmWindU_ = uwinds()[i];
+            speed.cdmWindV_ = vwinds()[i];
+            speed.cdmWindUnit_ = wdbunit;
+            speed.cdmGridName_ = uwinds()[i];
 
-            EntryToLoad direction;
+            EntryToLoad& direction = winds["wind from direction" + boost::lexical_cast<string>(i)];
             direction.wdbName_ = "wind from direction";
             direction.cdmName_ = "wind_from_direction";
             direction.standardName_ = "wind_from_direction";
@@ -357,31 +589,21 @@ namespace wdb { namespace load { namespace point {
             direction.wdbDataProvider_ = wdbdataprovider;
             direction.wdbLevelName_ = levelname;
             direction.wdbLevels_ = levels;
-            direction.cdmData_ = boost::shared_array<double>(new double[tds]);
             direction.cdmShape_ = shape;
             direction.cdmLevelName_ = lDimName;
+            direction.cdmXName_ = uVariable->xAxis;
+            direction.cdmYName_ = uVariable->yAxis;
             direction.cdmXDimLength_ = xDimLength;
             direction.cdmYDimLength_ = yDimLength;
-
-            for(size_t t = 0; t < tds; ++t) {
-                speed.cdmData_[t] = sqrt(uwinddata[t]*uwinddata[t] + vwinddata[t]*vwinddata[t]);
-                double dir = (3/2)*PI - atan2(vwinddata[t], uwinddata[t]);
-                while(dir > 2*PI) {
-                    dir = dir - 2*PI;
-                }
-                direction.cdmData_[t] = dir;
-            }
-
-            winds.insert(make_pair<string, EntryToLoad>(speed.wdbName_+boost::lexical_cast<string>(i), speed));
-            winds.insert(make_pair<string, EntryToLoad>(direction.wdbName_+boost::lexical_cast<string>(i), direction));
+            direction.cdmWindU_ = uwinds()[i];
+            direction.cdmWindV_ = vwinds()[i];
+            direction.cdmWindUnit_ = wdbunit;
+            direction.cdmGridName_ = uwinds()[i];
         }
 
-        // clear Entry2Load items
-        entries2load().clear();
-
-        // insert wind related param as
-        // new Entry2Load items
-        entries2load() = winds;
+        // the wind related params replace
+        // the Entry2Load items
+        entries2load().swap(winds);
 
         loadEntries();
     }
@@ -398,8 +620,7 @@ namespace wdb { namespace load { namespace point {
     {
         WDB_LOG & log = WDB_LOG::getInstance( "wdb.pointLoad.FileLoader" );
 
-        string dataprovider;
-        const CDM& cdmRef = cdmData_->getCDM();
+        PointWriter& writer = controller_.pointWriter();
 
         // eps - realization variable
         size_t epsLength = 1;
@@ -409,11 +630,11 @@ namespace wdb { namespace load { namespace point {
 
         // 1. check if there are ensemble members
         boost::shared_array<int> realizations;
-        const CDMDimension* epsDim = 0;
-        if(!cdmRef.findVariables("standard_name", epsCFName).empty()) {
-            epsVariableName = cdmRef.findVariables("standard_name", epsCFName)[0];
-            epsDim = &cdmRef.getDimension(epsVariableName);
-            epsLength = epsDim->getLength();
+        bool hasEps = false;
+        if(!index_.withStandardName(epsCFName).empty()) {
+            epsVariableName = index_.withStandardName(epsCFName)[0]->name;
+            hasEps = true;
+            epsLength = index_.dimensionLength(epsVariableName);
             realizations = cdmData_->getData(epsVariableName)->asInt();
             epsMaxVersion = realizations[epsLength - 1];
         }
@@ -426,37 +647,50 @@ namespace wdb { namespace load { namespace point {
             strReferenceTime = times_[0];
 	}
 
-        // 3. iterate Entry2Load map
+        writer.beginEntries(strReferenceTime, times());
+
+        // values are read, staged and computed in single precision on request
+        if(options().loading().precision != "double" && options().loading().precision != "float")
+            throw runtime_error("Unknown precision: " + options().loading().precision);
+        const bool single = options().loading().precision == "float";
+        if(options().loading().windDirection != "exact" && options().loading().windDirection != "fast")
+            throw runtime_error("Unknown wind direction: " + options().loading().windDirection);
+        const size_t valueSize = single ? sizeof(float) : sizeof(double);
+
+        // 3. plan each entry of Entry2Load map - variable, levels, stations and slabs
+        // are all looked up before any data is read, so that the reads can run ahead
+        // on the prefetch thread, which is then the only user of cdmData_
+        const size_t prefetch = options().loading().prefetch;
+        vector<EntryPlan> plans;
+        vector<pair<size_t, size_t> > reads;
         for(map<string, EntryToLoad>::const_iterator it = entries2load().begin(); it != entries2load().end(); ++it)
         {
             const EntryToLoad& entry(it->second);
+            plans.push_back(EntryPlan());
+            EntryPlan& plan = plans.back();
+            plan.entry = &entry;
+            plan.load = false;
             // some configuration files have "none" as units
             // for Fimex this should be "1"
-            string wdbunit = (entry.wdbUnit_ == "none") ? "1" : entry.wdbUnit_;
-            // 4. write data privder on a separate line (required bywdb-fastload format)
-            if(dataprovider != entry.wdbDataProvider_) {
-                dataprovider = entry.wdbDataProvider_;
-                string dpLine = "\n" + dataprovider + "\t88,0,88\n";
-                controller_.write(dpLine);
-            }
+            plan.unit = (entry.wdbUnit_ == "none") ? "1" : entry.wdbUnit_;
 
             string fimexname;
             string fimexlevelname;
+            string fimexXName;
+            string fimexYName;
             size_t fimexXDimLength;
             size_t fimexYDimLength;
             vector<string> fimexshape;
-            boost::shared_array<double> values;
 
             log.debugStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "]" << " entry.wdbName_: "<< entry.wdbName_ ;
             log.debugStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "]"  << " entry.cdmName_: "<< entry.cdmName_;
 
             string fimexstandardname(entry.standardName_);
-            string wdbstandardname(entry.wdbName_);
 
-            // 5. see if we have already fetched data for param from CDMReader
-            if(entry.cdmData_.get() == 0) {
+            // 4. find the variable in fimex CDMReader, unless it is computed (see loadWindEntries)
+            if(entry.cdmWindU_.empty()) {
                 boost::algorithm::replace_all(fimexstandardname, " ", "_");
-                vector<string> variables = cdmRef.findVariables("standard_name", fimexstandardname);
+                const vector<const CDMIndex::Variable*>& variables = index_.withStandardName(fimexstandardname);
                 if(variables.empty()) {
                     log.warnStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "]" << "cant find vars for fimexstandardname: " << fimexstandardname;
                     continue;
@@ -466,161 +700,491 @@ namespace wdb { namespace load { namespace point {
                     //log.errorStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "]" << ss.str();
                     throw std::runtime_error(ss.str());
                 }
-                const MetNoFimex::CDMVariable fimexVar = cdmRef.getVariable(variables[0]);
-                if(find(uwinds().begin(), uwinds().end(), fimexVar.getName()) != uwinds().end()
+                const CDMIndex::Variable& fimexVar = *variables[0];
+                if(find(uwinds().begin(), uwinds().end(), fimexVar.name) != uwinds().end()
                         ||
-                        find(vwinds().begin(), vwinds().end(), fimexVar.getName()) != vwinds().end())
+                        find(vwinds().begin(), vwinds().end(), fimexVar.name) != vwinds().end())
                 {
                     continue;
                 }
 
-                string lonName;
-                string latName;
-                string xName = cdmRef.getHorizontalXAxis(fimexVar.getName());
-                string yName = cdmRef.getHorizontalYAxis(fimexVar.getName());
-                fimexXDimLength = cdmRef.getDimension(xName).getLength();
-                fimexYDimLength = cdmRef.getDimension(yName).getLength();
-
-
-                if(!cdmRef.getLatitudeLongitude(fimexVar.getName(), latName, lonName)) {
+                if(!fimexVar.hasLatitudeLongitude) {
                     stringstream ss;
-                    ss << "lat and lon not defined for fimex varName: " << fimexVar.getName();
+                    ss << "lat and lon not defined for fimex varName: " << fimexVar.name;
                     throw runtime_error(ss.str());
                 }
-
-                boost::shared_ptr<MetNoFimex::Data> raw = cdmData_->getScaledDataInUnit(fimexVar.getName(), wdbunit);
-                if(raw->size() == 0)
-                    continue;
-
-                values = raw->asDouble();
+                fimexXName = fimexVar.xAxis;
+                fimexYName = fimexVar.yAxis;
+                fimexXDimLength = fimexVar.xLength;
+                fimexYDimLength = fimexVar.yLength;
 
                 // we deal only with variable that are time dependant
-                list<string> dims(fimexVar.getShape().begin(), fimexVar.getShape().end());
-                if(find(dims.begin(), dims.end(), "time") == dims.end()) {
+                if(!fimexVar.timeDependent) {
                     log.debugStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "]" << "not time dependent: " << fimexstandardname;
                     continue;
                 }
-                fimexname = fimexVar.getName();
-                fimexshape = fimexVar.getShape();
-                fimexlevelname = cdmRef.getVerticalAxis(fimexname);
+
+                fimexname = fimexVar.name;
+                fimexshape = fimexVar.shape;
+                fimexlevelname = fimexVar.verticalAxis;
             } else {
-                values = entry.cdmData_;
                 fimexname = entry.cdmName_;
                 fimexshape = entry.cdmShape_;
                 fimexlevelname = entry.cdmLevelName_;
+                fimexXName = entry.cdmXName_;
+                fimexYName = entry.cdmYName_;
                 fimexXDimLength = entry.cdmXDimLength_;
                 fimexYDimLength = entry.cdmYDimLength_;
             }
+            plan.name = fimexname;
+
+            // 5. match each requested level (as confgured by levelparameter.conf and/or leveladditions.conf)
+            // to its index in fimex CDMReader (that is CDM modell) - each vertical axis is read once per file
+            vector<pair<size_t, size_t> > levelIndexes;
+            plan.levelLength = 1;
+            boost::shared_array<double> fimexLevels;
+            if(!fimexlevelname.empty()) {
+                plan.levelLength = index_.dimensionLength(fimexlevelname);
+                fimexLevels = levelAxis(fimexlevelname);
+            }
+            for(set<double>::const_iterator lIt = entry.wdbLevels_.begin(); lIt != entry.wdbLevels_.end(); ++lIt) {
+                size_t wdbLevel = *lIt;
+                size_t fimexLevelIndex = levelIndex(fimexLevels, plan.levelLength, wdbLevel);
+                levelIndexes.push_back(make_pair(wdbLevel, fimexLevelIndex));
+                plan.levelIndexes.push_back(fimexLevelIndex);
+            }
+
+            // only the requested levels are read, a run of consecutive levels at a time,
+            // and staged from their position among the levels read
+            vector<pair<size_t, size_t> > levelRuns;
+            if(!fimexlevelname.empty() && !plan.levelIndexes.empty()) {
+                set<size_t> requested(plan.levelIndexes.begin(), plan.levelIndexes.end());
+                if(requested.size() < plan.levelLength) {
+                    vector<size_t> positions(plan.levelLength, 0);
+                    size_t position = 0;
+                    for(set<size_t>::const_iterator level = requested.begin(); level != requested.end(); ++level, ++position) {
+                        if(levelRuns.empty() || levelRuns.back().first + levelRuns.back().second != *level)
+                            levelRuns.push_back(make_pair(*level, size_t(0)));
+                        ++levelRuns.back().second;
+                        positions[*level] = position;
+                    }
+                    for(size_t l = 0; l < plan.levelIndexes.size(); ++l)
+                        plan.levelIndexes[l] = positions[plan.levelIndexes[l]];
+                    plan.levelLength = requested.size();
+                }
+            }
 
-            // 6. iterate by each position
-            // X dim grows faster than Y dim
-            for(size_t i = 0; i < fimexYDimLength; ++i) {
-                for(size_t j = 0; j < fimexXDimLength; ++j){
-
-                    stringstream wkt;
-                    wkt <<  "point" << "(" << controller_.longitudes()[i * fimexXDimLength + j] << " " << controller_.latitudes()[i * fimexXDimLength + j] << ")";
-
-                    // 7. iterate all requested levels (as confgured by levelparameter.conf and/or leveladditions.conf)
-                    for(set<double>::const_iterator lIt = entry.wdbLevels_.begin(); lIt != entry.wdbLevels_.end(); ++lIt) {
-                        size_t wdbLevel = *lIt;
-                        size_t fimexLevelIndex = 0;
-                        size_t fimexLevelLength = 1;
-                        if(!fimexlevelname.empty()) {
-                            // match wdbIndex to index in fimex CDMReader (that is CDM modell)
-                            MetNoFimex::CDMVariable fimexLevelVar = cdmRef.getVariable(fimexlevelname);
-                            fimexLevelLength = cdmRef.getDimension(fimexlevelname).getLength();
-                            boost::shared_ptr<Data> levelData = cdmData_->getData(fimexLevelVar.getName());
-                            boost::shared_array<double> fimexLevels = levelData->asDouble();
-                            for(size_t index = 0; index < fimexLevelLength; ++ index) {
-                                if(wdbLevel == fimexLevels[index]) {
-                                    fimexLevelIndex = index;
-                                    break;
-                                }
-                            }
-                        }
-
-                        int version = 0;
-                        bool hasEpsAsDim = false;
-
-                        // 8. log the number of ensemble members (default 1)
-                        if(epsDim != 0) {
-                            list<string> dims(fimexshape.begin(), fimexshape.end());
-                            if(find(dims.begin(), dims.end(), epsVariableName) != dims.end()) {
-                                hasEpsAsDim = true;
-                            }
-                        } else {
-                            version = 0;
-                            epsLength = 1;
-                        }
-
-                        // 9. iterate each eps member
-                        for(size_t e = 0; e < epsLength; ++e)
-                        {
-                            // 10. time by time slice
-                            for(size_t u = 0; u < times().size(); ++u)
-                            {
-                                double value;
-
-                                if(hasEpsAsDim) {
-                                    version = realizations[e];
-
-                                    value = *
-                                            (values.get() // jump to data start
-                                             + u*(epsLength * fimexLevelLength * fimexXDimLength * fimexYDimLength ) // jump to u-th time slice
-                                             + e * fimexLevelLength * fimexXDimLength * fimexYDimLength // jump to e-th realization-slice
-                                             + fimexLevelIndex * fimexXDimLength * fimexYDimLength // jump to right level
-                                             + i * fimexXDimLength + j); // jump to right x,y coordinate
-
-                                } else {
-                                    version = 0;
-
-                                    value = *
-                                            (values.get() // jump to data start
-                                             + u*(fimexLevelLength * fimexXDimLength * fimexYDimLength ) // jump to u-th time slice
-                                             + fimexLevelIndex * fimexXDimLength * fimexYDimLength // jump to right level
-                                             + i * fimexXDimLength + j); // jump to right x,y coordinate
-
-                                }
-
-                                string validtime = times()[u];
-
-                                try {
-                                    stringstream cmd;
-
-                                    cmd << value            << "\t"
-                                        << wkt.str()        << "\t"
-                                        << strReferenceTime << "\t"
-                                        << validtime        << "\t"
-                                        << validtime        << "\t"
-                                        << wdbstandardname     << "\t"
-                                        << entry.wdbLevelName_ << "\t"
-                                        << wdbLevel         << "\t"
-                                        << wdbLevel         << "\t"
-                                        << version          << "\t"
-                                        << epsMaxVersion
-                                        << endl;
-
-                                    if(value != value) {
-                                        // IEEE way tom test for NaN
-                                        log.debugStream() << cmd.str();
-                                        continue;
-                                    } else {
-                                        controller_.write(cmd.str());
-                                    }
-
-                                } catch ( wdb::ignore_value &e ) {
-                                    log.warnStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "]" << e.what() << " Data field not loaded.";
-                                } catch ( out_of_range &e ) {
-                                    log.warnStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "]" << "Metadata missing for data value. " << e.what() << " Data field not loaded.";
-                                } catch ( exception & e ) {
-                                    log.warnStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "]" << e.what() << " Data field not loaded.";
-                                }
-                            } // time slices end
-                        } // eps slices
-                    } // z slices
-                } // x slices
-            } // y slices
+            // 6. log the number of ensemble members (default 1)
+            bool hasEpsAsDim = false;
+            if(hasEps)
+                hasEpsAsDim = find(fimexshape.begin(), fimexshape.end(), epsVariableName) != fimexshape.end();
+
+            // 7. plan the reads slab by slab (--slab.stations), a slab being all times, requested
+            // levels and members of a block of stations, so that the output order is kept
+            // only the stations inside the grid are staged (see activeStations)
+            const size_t stations = fimexXDimLength * fimexYDimLength;
+            const vector<size_t>& active = activeStations(entry.cdmGridName_.empty() ? fimexname : entry.cdmGridName_, stations);
+            // allStations_ is resized for grids of another size
+            plan.active = (&active == &allStations_) ? 0 : &active;
+
+            // while a slab is read the data read and its copy as doubles are held (plus the levels
+            // put together when reading level runs), for wind with the u read before (the speed and
+            // direction overwrite u and v); while it is staged, the values read and the staged ones;
+            // with prefetch both happen at once, and the slabs read ahead wait as read
+            plan.members = hasEpsAsDim ? epsLength : 1;
+            plan.readCopies = (levelRuns.empty() ? 2 : 3) + (entry.cdmWindU_.empty() ? 0 : 1);
+            const size_t seriesBytes = times().size() * plan.members * valueSize;
+            const size_t reading = plan.readCopies * plan.levelLength;
+            const size_t staging = plan.levelLength + plan.levelIndexes.size();
+            const size_t stationBytes = seriesBytes * (prefetch > 0 ? reading + staging + prefetch * plan.levelLength : max(reading, staging));
+
+            plan.slab.whole = true;
+            plan.slab.start = 0;
+            plan.slab.size = stations;
+            plan.slab.stride = 1;
+            plan.slab.stations = stations;
+            plan.slab.levelDimension = levelRuns.empty() ? string() : fimexlevelname;
+            plan.slab.levelRuns = levelRuns;
+            size_t slabStations = options().loading().slabStations;
+            // a quarter of the budget is left to the read cache (see writePlanned)
+            if(slabStations == 0 && options().loading().memoryLimit > 0 && stationBytes > 0)
+                slabStations = max<size_t>(1, (options().loading().memoryLimit << 20) / 4 * 3 / stationBytes);
+            if(slabStations > 0 && slabStations < stations) {
+                // slices along y keep whole rows of x
+                plan.slab.whole = false;
+                plan.slab.dimension = fimexYDimLength > 1 ? fimexYName : fimexXName;
+                plan.slab.stride = fimexYDimLength > 1 ? fimexXDimLength : 1;
+                plan.slab.size = max<size_t>(1, slabStations / plan.slab.stride);
+            }
+            plan.slabLength = stations / plan.slab.stride;
+            for(size_t start = 0; start < plan.slabLength; start += plan.slab.size)
+                reads.push_back(make_pair(plans.size() - 1, start));
+
+            // the station loop is specialized for entries with and without members
+            if(single)
+                plan.writeStations = hasEpsAsDim ? &FileLoader::writeStations<true, float> : &FileLoader::writeStations<false, float>;
+            else
+                plan.writeStations = hasEpsAsDim ? &FileLoader::writeStations<true, double> : &FileLoader::writeStations<false, double>;
+            plan.loop.levels = levelIndexes;
+            plan.loop.members = epsLength;
+            plan.loop.realizations = realizations;
+            plan.loop.maxVersion = epsMaxVersion;
+            plan.load = true;
         } // entries2load
+
+        // 8. the slabs are read, staged and written in the precision asked for
+        if(single)
+            writePlanned<float>(writer, plans, reads);
+        else
+            writePlanned<double>(writer, plans, reads);
+
+        writer.endEntries();
+        log.debugStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "]" << " " << levelAxes_.size() << " vertical axes read for " << entries2load().size() << " entries";
+    }
+
+    template<typename T>
+    void FileLoader::writePlanned(PointWriter& writer, vector<EntryPlan>& plans, const vector<pair<size_t, size_t> >& reads)
+    {
+        WDB_LOG & log = WDB_LOG::getInstance( "wdb.pointLoad.FileLoader" );
+
+        // the slabs are read in order, up to --prefetch of them ahead on a reader thread,
+        // while the ones read are staged: rearranged into [station][level][member][time]
+        // count the reads of each variable, slab and levels, so that values
+        // several entries ask for are read once (see ReadCache), and the wind
+        // speed or direction computed along with the other; the entries are
+        // read one after the other, so the cache keeps at most a quarter of
+        // --memory.limit, or without it the reads of one slab, rather than
+        // every slab of an entry until the next one asks for them
+        ReadCache<T>& cache = readCache<T>();
+        size_t slabReads = 0;
+        for(size_t p = 0; p < plans.size(); ++p) {
+            const EntryPlan& plan = plans[p];
+            if(plan.load)
+                slabReads = max(slabReads, plan.slab.size * plan.slab.stride * plan.levelLength * plan.members * times().size() * sizeof(T));
+        }
+        slabReadBytes_ = max(slabReadBytes_, slabReads);
+        const size_t memoryLimit = options().loading().memoryLimit << 20;
+        cache.setCapacity(memoryLimit > 0 ? memoryLimit / 4 : max<size_t>(1, slabReads));
+        for(size_t r = 0; r < reads.size(); ++r) {
+            const EntryPlan& plan = plans[reads[r].first];
+            const Slab slab = slabAt(plan, reads[r].second);
+            if(plan.entry->cdmWindU_.empty())
+                cache.plan(readKey(plan.name, plan.unit, slab));
+            else
+                cache.plan(windKey(*plan.entry, plan.name, slab));
+        }
+        const size_t hits = cache.hits();
+
+        const size_t prefetch = options().loading().prefetch;
+        SlabPrefetcher<T> prefetcher(boost::bind(&FileLoader::readPlanned<T>, this, &plans, &reads, _1, _2), reads.size(), prefetch);
+        BasicStagedEntry<T>& staged = this->staged<T>();
+        for(size_t p = 0; p < plans.size(); ++p)
+        {
+            EntryPlan& plan = plans[p];
+            const EntryToLoad& entry = *plan.entry;
+            // 9. start the entry - writes data provider on a separate line when it changes
+            writer.beginEntry(entry.wdbDataProvider_, entry.wdbName_, entry.wdbLevelName_);
+            if(!plan.load)
+                continue;
+
+            size_t missing = 0;
+            size_t stagedValues = 0;
+            size_t nextActive = 0;
+            for(size_t start = 0; start < plan.slabLength; start += plan.slab.size) {
+                const size_t first = start * plan.slab.stride;
+                const size_t last = first + min(plan.slab.size, plan.slabLength - start) * plan.slab.stride;
+
+                size_t size = 0;
+                boost::shared_array<T> values = prefetcher.next(size);
+                if(size == 0)
+                    continue;
+
+                // the active stations of the slab, relative to it and in the template
+                vector<size_t> slabActive;
+                vector<size_t> slabStationIds;
+                for(size_t s = first; s < last; ++s) {
+                    if(plan.active != 0) {
+                        if(nextActive == plan.active->size() || (*plan.active)[nextActive] != s)
+                            continue;
+                        ++nextActive;
+                    }
+                    slabActive.push_back(s - first);
+                    slabStationIds.push_back(s);
+                }
+                staged.stage(values.get(), last - first, slabActive, plan.levelIndexes, plan.levelLength, plan.members, times().size());
+                const size_t slabBytes = size * sizeof(T);
+                const size_t held = prefetch > 0 ? plan.readCopies * slabBytes + slabBytes + staged.bytes()
+                                                 : max(plan.readCopies * slabBytes, slabBytes + staged.bytes());
+                peakBytes_ = max(peakBytes_, held + prefetcher.bytes() + cache.bytes());
+                values.reset();
+                missing += staged.missing();
+                stagedValues += staged.size();
+                plan.loop.stations = &slabStationIds;
+
+                // 10. station blocks are written in parallel (--threads) when the output format allows,
+                // a chunk of blocks at a time, and joined in station order
+                writeSlab(writer, plan.writeStations, plan.loop, slabActive.size());
+            }
+            if(missing > 0)
+                log.infoStream() << entry.wdbName_ << ": " << missing << " of " << stagedValues << " values missing (NaN)";
+        } // plans
+
+        log.debugStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "]" << " waited " << prefetcher.stalls() << " times for " << reads.size() << " slabs read";
+        log.debugStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "]" << " " << cache.hits() - hits << " reads shared through the read cache";
+        readCachePeakBytes_ = max(readCachePeakBytes_, cache.peakBytes());
+    }
+
+    void FileLoader::writeSlab(PointWriter& writer, StationWriter writeStations, const EntryLoop& loop, size_t staged)
+    {
+        const size_t threads = max<size_t>(1, options().loading().threads);
+        const size_t valuesPerStation = max<size_t>(1, loop.levels.size() * loop.members * times().size());
+        const size_t blockStations = max<size_t>(1, valuesPerBlock / valuesPerStation);
+        size_t station = 0;
+        while(threads > 1 && station < staged) {
+            vector<boost::shared_ptr<PointWriter> > blocks;
+            for(size_t b = 0; b < threads && station + b * blockStations < staged; ++b) {
+                PointWriter* block = writer.fork();
+                if(block == 0)
+                    break;
+                blocks.push_back(boost::shared_ptr<PointWriter>(block));
+            }
+            if(blocks.empty())
+                break;
+
+            string error;
+            #pragma omp parallel for num_threads(threads) schedule(dynamic)
+            for(int b = 0; b < int(blocks.size()); ++b) {
+                try {
+                    const size_t begin = station + b * blockStations;
+                    (this->*writeStations)(*blocks[b], loop, begin, min(staged, begin + blockStations));
+                } catch(std::exception& e) {
+                    #pragma omp critical
+                    error = e.what();
+                }
+            }
+            if(!error.empty())
+                throw runtime_error(error);
+
+            for(size_t b = 0; b < blocks.size(); ++b)
+                writer.join(*blocks[b]);
+            station = min(staged, station + blocks.size() * blockStations);
+        }
+        (this->*writeStations)(writer, loop, station, staged);
+    }
+
+    /*
+     * Reads the values of the entry for a slab of stations, in the unit given;
+     * wind entries are computed from their u and v components (read in their own unit),
+     * speed and direction in one pass, the one not asked for being kept in the read
+     * cache for its own entry
+     **/
+    template<typename T>
+    boost::shared_array<T> FileLoader::readSlab(const EntryToLoad& entry, const string& name, const string& unit, const Slab& slab, size_t& size)
+    {
+        if(entry.cdmWindU_.empty())
+            return readLevels<T>(name, unit, slab, size);
+
+        ReadCache<T>& cache = readCache<T>();
+        boost::shared_array<T> values;
+        if(cache.take(windKey(entry, name, slab), values, size))
+            return values;
+
+        size_t vsize = 0;
+        boost::shared_array<T> u = readLevelsOf<T>(entry.cdmWindU_, entry.cdmWindUnit_, slab, size);
+        boost::shared_array<T> v = readLevelsOf<T>(entry.cdmWindV_, entry.cdmWindUnit_, slab, vsize);
+        if(size != vsize)
+            throw runtime_error("datasizes for wind componenets don't match");
+
+        const bool speed = name == "wind_speed";
+        const string otherKey = windKey(entry, speed ? "wind_from_direction" : "wind_speed", slab);
+        const bool both = cache.wants(otherKey, size);
+        // computed in place, so that whole variables take no more than u and v
+        boost::shared_array<T> speeds(speed || both ? u : boost::shared_array<T>());
+        boost::shared_array<T> directions(!speed || both ? v : boost::shared_array<T>());
+        WindCDMReader::winds(u.get(), v.get(), size, speeds.get(), directions.get(), options().loading().windDirection == "fast");
+        if(both)
+            cache.keep(otherKey, speed ? directions : speeds, size);
+        return speed ? speeds : directions;
+    }
+
+    /*
+     * Reads a variable for a slab of stations; with level runs, only those
+     * levels are read, one run at a time, and put together as if the
+     * vertical axis had only them
+     **/
+    template<typename T>
+    boost::shared_array<T> FileLoader::readLevels(const string& name, const string& unit, const Slab& slab, size_t& size)
+    {
+        const string key = readKey(name, unit, slab);
+        boost::shared_array<T> values;
+        if(readCache<T>().take(key, values, size))
+            return values;
+
+        values = readLevelsOf<T>(name, unit, slab, size);
+        readCache<T>().keep(key, values, size);
+        return values;
+    }
+
+    template<typename T>
+    boost::shared_array<T> FileLoader::readLevelsOf(const string& name, const string& unit, const Slab& slab, size_t& size)
+    {
+        if(slab.levelRuns.empty()) {
+            boost::shared_ptr<Data> raw = readSlab(name, unit, slab, 0);
+            size = raw->size();
+            return asArray(*raw, T());
+        }
+
+        size_t levels = 0;
+        for(size_t r = 0; r < slab.levelRuns.size(); ++r)
+            levels += slab.levelRuns[r].second;
+
+        boost::shared_array<T> values;
+        size = 0;
+        size_t level = 0;
+        for(size_t r = 0; r < slab.levelRuns.size(); ++r) {
+            const pair<size_t, size_t>& run = slab.levelRuns[r];
+            boost::shared_ptr<Data> raw = readSlab(name, unit, slab, &run);
+            // [time][member][level][station] with the run's levels
+            const size_t runValues = run.second * slab.stations;
+            const size_t blocks = raw->size() / runValues;
+            if(r == 0) {
+                size = blocks * levels * slab.stations;
+                values.reset(new T[size]);
+            } else if(blocks * levels * slab.stations != size) {
+                throw runtime_error("level slices of " + name + " differ in size");
+            }
+            boost::shared_array<T> part = asArray(*raw, T());
+            raw.reset();
+            for(size_t b = 0; b < blocks; ++b)
+                copy(&part[b * runValues], &part[b * runValues] + runValues, &values[(b * levels + level) * slab.stations]);
+            level += run.second;
+        }
+        return values;
+    }
+
+    template<typename T>
+    boost::shared_array<T> FileLoader::readPlanned(const vector<EntryPlan>* plans, const vector<pair<size_t, size_t> >* reads, size_t read, size_t& size)
+    {
+        const EntryPlan& plan = (*plans)[(*reads)[read].first];
+        return readSlab<T>(*plan.entry, plan.name, plan.unit, slabAt(plan, (*reads)[read].second), size);
+    }
+
+    FileLoader::Slab FileLoader::slabAt(const EntryPlan& plan, size_t start) const
+    {
+        Slab slab = plan.slab;
+        slab.start = start;
+        slab.stations = min(slab.size, plan.slabLength - slab.start) * slab.stride;
+        return slab;
+    }
+
+    string FileLoader::readKey(const string& name, const string& unit, const Slab& slab)
+    {
+        stringstream key;
+        key << name << '\t' << unit;
+        if(!slab.whole)
+            key << '\t' << slab.dimension << ' ' << slab.start << ' ' << slab.size;
+        if(!slab.levelRuns.empty()) {
+            key << '\t' << slab.levelDimension;
+            for(size_t r = 0; r < slab.levelRuns.size(); ++r)
+                key << ' ' << slab.levelRuns[r].first << '+' << slab.levelRuns[r].second;
+        }
+        return key.str();
+    }
+
+    string FileLoader::windKey(const EntryToLoad& entry, const string& name, const Slab& slab)
+    {
+        return readKey(name + " of " + entry.cdmWindU_ + " " + entry.cdmWindV_, entry.cdmWindUnit_, slab);
+    }
+
+    boost::shared_ptr<Data> FileLoader::readSlab(const string& name, const string& unit, const Slab& slab, const pair<size_t, size_t>* levels)
+    {
+        // the slabs of a variable are read one at a time, on one thread
+        sliceReads_ += times().size();
+        if(!slab.whole && slab.start > 0)
+            repeatedSliceReads_ += times().size();
+
+        if(slab.whole && levels == 0)
+            return cdmData_->getScaledDataInUnit(name, unit);
+
+        SliceBuilder slice(cdmData_->getCDM(), name);
+        if(!slab.whole)
+            slice.setStartAndSize(slab.dimension, slab.start, min(slab.size, index_.dimensionLength(slab.dimension) - slab.start));
+        if(levels != 0)
+            slice.setStartAndSize(slab.levelDimension, levels->first, levels->second);
+        return cdmData_->getScaledDataSliceInUnit(name, unit, slice);
+    }
+
+    template<bool HasEps, typename T>
+    void FileLoader::writeStations(PointWriter& writer, const EntryLoop& loop, size_t begin, size_t end)
+    {
+        const size_t timeLength = times().size();
+        const BasicStagedEntry<T>& staged = this->staged<T>();
+        const T* values = staged.data();
+
+        // 10. iterate by each position (staged stations are the active ones)
+        // X dim grows faster than Y dim
+        for(size_t s = begin; s < end; ++s) {
+            const size_t station = (*loop.stations)[s];
+
+            // 11. iterate all requested levels
+            for(size_t l = 0; l < loop.levels.size(); ++l) {
+                writer.setLevel(loop.levels[l].first);
+
+                // 12. iterate each eps member
+                for(size_t e = 0; e < loop.members; ++e)
+                {
+                    writer.setVersion(HasEps ? loop.realizations[e] : 0, loop.maxVersion);
+
+                    // 13. time by time slice, skipping missing (NaN) values by the staged validity mask
+                    const size_t first = staged.seriesIndex(s, l, HasEps ? e : 0);
+                    const size_t last = first + timeLength;
+                    for(size_t i = staged.nextValid(first, last); i < last; i = staged.nextValid(i + 1, last))
+                        writer.write(values[i], station, i - first);
+                } // eps slices
+            } // z slices
+        } // stations
+    }
+
+    /*
+     * The stations of the template inside the grid variable is on: those the
+     * interpolated domain variable (see markDomainCDM) is not NaN for.
+     * Computed once per grid definition and kept for the following files.
+     **/
+    const vector<size_t>& FileLoader::activeStations(const string& variable, size_t stations)
+    {
+        WDB_LOG & log = WDB_LOG::getInstance( "wdb.pointLoad.FileLoader" );
+
+        if(allStations_.size() != stations) {
+            allStations_.resize(stations);
+            for(size_t s = 0; s < stations; ++s)
+                allStations_[s] = s;
+        }
+
+        string domain = domain_.get() ? domain_->domainOf(variable) : string();
+        if(domain.empty() || controller_.pointWriter().everyStation())
+            return allStations_;
+
+        const string key = domain_->gridKey(domain);
+        map<string, vector<size_t> >::const_iterator cached = activeStations_.find(key);
+        if(cached != activeStations_.end())
+            return cached->second;
+
+        boost::shared_ptr<Data> inside = cdmData_->getScaledData(domain);
+        vector<size_t>& active = activeStations_[key];
+        active.clear();
+        if(inside->size() != stations) {
+            log.warnStream() << "Domain of " << variable << " has " << inside->size() << " values for " << stations << " stations, using all stations";
+            active = allStations_;
+            return active;
+        }
+
+        boost::shared_array<double> values = inside->asDouble();
+        for(size_t s = 0; s < stations; ++s) {
+            if(values[s] == values[s])
+                active.push_back(s);
+        }
+        log.infoStream() << active.size() << " of " << stations << " stations inside the grid of " << variable;
+        return active;
     }
 
     // TODO: Remove FileLoaderFactory to it's own file
@@ -33,6 +33,9 @@
 #include "Loader.hpp"
 #include "CmdLine.hpp"
 #include "CfgFileReader.hpp"
+#include "StagedEntry.hpp"
+#include "CDMIndex.hpp"
+#include "ReadCache.hpp"
 
 #include <boost/shared_ptr.hpp>
 #include <boost/shared_array.hpp>
@@ -41,10 +44,13 @@ using namespace std;
 
 namespace MetNoFimex {
     class CDMReader;
+    class Data;
 }
 
 namespace wdb { namespace load { namespace point {
 
+    class DomainCDMReader;
+
     /*
      * Struct that holds various metadata for parameters that are to be extracted from field data files
      * i,e. how should parameter be named in WDB, what units to be used, which levels to be loaded ...
@@ -58,11 +64,16 @@ namespace wdb { namespace load { namespace point {
         string wdbDataProvider_;
         string wdbLevelName_;
         set<double> wdbLevels_;
+        string cdmXName_;
+        string cdmYName_;
         size_t cdmXDimLength_;
         size_t cdmYDimLength_;
         string cdmLevelName_;
         vector<string> cdmShape_;
-        boost::shared_array<double> cdmData_;
+        string cdmGridName_;    // variable on the grid of the entry, when not cdmName_
+        string cdmWindU_;       // u and v components a wind entry is computed from
+        string cdmWindV_;
+        string cdmWindUnit_;    // unit the components are read in
     };
 
     /*
@@ -83,6 +94,24 @@ namespace wdb { namespace load { namespace point {
         // Extract data for wdb-fastload consumption
         void load(const string& fileName);
 
+        // Write the interpolated data as a station NetCDF file (--output.format=netcdf)
+        void writeNetCDF(const string& fileName, const string& outFileName);
+
+        // Reads decoded from the files so far, and reads shared through the read cache
+        size_t decodedReads() const { return readCache_.misses() + readCacheFloat_.misses(); }
+        size_t cachedReads() const { return readCache_.hits() + readCacheFloat_.hits(); }
+        // Estimated peak slab memory of the last file loaded (see --memory.limit)
+        size_t peakBytes() const { return peakBytes_; }
+        // Time slices of the last file decoded and interpolated again for slabs past the first
+        size_t repeatedSliceReads() const { return repeatedSliceReads_; }
+        // Most bytes held by the read cache, and the most the reads of one slab take, over the files so far
+        size_t readCachePeakBytes() const { return readCachePeakBytes_; }
+        size_t slabReadBytes() const { return slabReadBytes_; }
+        // Reads of each vertical axis over the files so far, once per file that uses it
+        const map<string, size_t>& levelAxisReads() const { return levelAxisReads_; }
+        // Template stations inside each grid met so far (see activeStations), by grid
+        const map<string, vector<size_t> >& activeStations() const { return activeStations_; }
+
     protected:
         /*
          * Opens/reads configuration files with the
@@ -91,14 +120,22 @@ namespace wdb { namespace load { namespace point {
          **/
         virtual void setup();
 
+        /*
+         * Drops everything read from the previous file: entries,
+         * time axis, wind components, readers and staged values
+         * (the active stations are kept, by grid definition)
+         **/
+        void resetFile();
+
         /*
          * Iterate through each record in the data files
          * and make a list of EntryToLoad items that will
          * represent parameters to be extracetd
          *
-         * Each file type konws how to to this
+         * Each file type konws how to to this; the entries
+         * are found before interpolation (see interpolateCDM)
          **/
-        virtual void loadInterpolated(const string& fileName) = 0;
+        virtual void findEntries(const string& fileName) = 0;
 
         /* Uses fimex to create CDMReader object
          *
@@ -111,7 +148,7 @@ namespace wdb { namespace load { namespace point {
         virtual bool openCDM(const std::string& file) = 0;
 
         /*
-         * iterates through each EntryToLoad item (see loadIntepolated )
+         * iterates through each EntryToLoad item (see findEntries )
          * reads the data from a fimex CDMReader object (see openCDM )
          * and assembles the data line to be sent to wdb-fastload
          *
@@ -120,6 +157,100 @@ namespace wdb { namespace load { namespace point {
          **/
         virtual void loadEntries();
 
+        // what writeStations needs to know about the entry being written
+        struct EntryLoop
+        {
+            const vector<size_t>* stations;         // template index of each staged station
+            vector<pair<size_t, size_t> > levels;   // wdb level, index in the staged values
+            size_t members;                         // eps members to iterate
+            boost::shared_array<int> realizations;
+            size_t maxVersion;
+        };
+
+        // values per block of stations written in parallel
+        static const size_t valuesPerBlock = 1 << 16;
+
+        // the part of a variable read at a time: size positions
+        // from start along dimension (the x or y axis), each
+        // holding stride stations; or the whole variable
+        struct Slab
+        {
+            bool whole;
+            string dimension;
+            size_t start;
+            size_t size;
+            size_t stride;
+            size_t stations;                            // stations in the slab
+            // runs of consecutive levels read (first, count) along levelDimension; all levels when empty
+            string levelDimension;
+            vector<pair<size_t, size_t> > levelRuns;
+        };
+
+        // read the values of an entry for a slab of stations, as double or float
+        template<typename T>
+        boost::shared_array<T> readSlab(const EntryToLoad& entry, const string& name, const string& unit, const Slab& slab, size_t& size);
+        // through the read cache
+        template<typename T>
+        boost::shared_array<T> readLevels(const string& name, const string& unit, const Slab& slab, size_t& size);
+        template<typename T>
+        boost::shared_array<T> readLevelsOf(const string& name, const string& unit, const Slab& slab, size_t& size);
+        boost::shared_ptr<MetNoFimex::Data> readSlab(const string& name, const string& unit, const Slab& slab, const pair<size_t, size_t>* levels);
+
+        /*
+         * writes the staged values of stations [begin, end)
+         * of the current entry (see loadEntries); HasEps tells
+         * whether the entry has the ensemble member dimension,
+         * T the precision of the staged values
+         **/
+        template<bool HasEps, typename T>
+        void writeStations(PointWriter& writer, const EntryLoop& loop, size_t begin, size_t end);
+        typedef void (FileLoader::*StationWriter)(PointWriter& writer, const EntryLoop& loop, size_t begin, size_t end);
+
+        // writes the staged stations with writeStations, in parallel blocks when --threads allows
+        void writeSlab(PointWriter& writer, StationWriter writeStations, const EntryLoop& loop, size_t staged);
+
+        // an entry as planned by loadEntries, before any of its slabs is read
+        struct EntryPlan
+        {
+            const EntryToLoad* entry;
+            bool load;                      // false when the entry has nothing to write
+            string name;                    // variable read (wind_speed and wind_from_direction for wind)
+            string unit;
+            vector<size_t> levelIndexes;    // fimex index of each level written
+            size_t levelLength;
+            size_t members;                 // members staged, 1 without the eps dimension
+            size_t readCopies;              // arrays of a slab's size held while reading it
+            const vector<size_t>* active;   // stations inside the grid, 0 for all of them
+            Slab slab;                      // the first slab
+            size_t slabLength;              // positions along slab.dimension
+            StationWriter writeStations;
+            EntryLoop loop;
+        };
+
+        // the slab of a planned entry starting at start
+        Slab slabAt(const EntryPlan& plan, size_t start) const;
+
+        // what identifies the values read for a slab in the read cache
+        static string readKey(const string& name, const string& unit, const Slab& slab);
+        // what identifies wind speed or direction (name) computed for a slab in the read cache
+        static string windKey(const EntryToLoad& entry, const string& name, const Slab& slab);
+
+        // read one of the planned slabs, reads holding the plan and slab start of each (see SlabPrefetcher)
+        template<typename T>
+        boost::shared_array<T> readPlanned(const vector<EntryPlan>* plans, const vector<pair<size_t, size_t> >* reads, size_t read, size_t& size);
+
+        // reads, stages and writes the planned entries (see loadEntries) in precision T
+        template<typename T>
+        void writePlanned(PointWriter& writer, vector<EntryPlan>& plans, const vector<pair<size_t, size_t> >& reads);
+
+        // the staged values of precision T
+        template<typename T>
+        BasicStagedEntry<T>& staged();
+
+        // the read cache of precision T
+        template<typename T>
+        ReadCache<T>& readCache();
+
         /*
          * If requested it will extract the u and v wind components
          * to calculate wind_speed and wind_direction as prescribed
@@ -130,6 +261,12 @@ namespace wdb { namespace load { namespace point {
          **/
         virtual void loadWindEntries();
 
+        /*
+         * Template stations inside the grid of the variable,
+         * all of them when unknown or when the writer needs every station
+         **/
+        const vector<size_t>& activeStations(const string& variable, size_t stations);
+
         // Extract time axis and unique forecast time from the data file
         virtual bool timeFromCDM();
 
@@ -137,12 +274,26 @@ namespace wdb { namespace load { namespace point {
         // based on u and v wind components
         virtual bool processCDM();
 
+        /*
+         * marks the area of each grid in the data (see DomainCDMReader)
+         * so that interpolation tells the stations outside it
+         **/
+        virtual bool markDomainCDM();
+
         /*
          * apply fimex template interpolation to the data
          * by using the created CDMReader (look openCDM )
+         * only the levels the entries ask for are interpolated
          **/
          virtual bool interpolateCDM();
 
+        // the span (first, count) of the levels the entries ask for
+        // along each vertical axis, where it is not the whole axis
+        map<string, pair<size_t, size_t> > levelSpans();
+
+        // the values of a vertical axis, read once per file
+        const boost::shared_array<double>& levelAxis(const string& name);
+
         /*
          * Read the units.conf file to find what units
          * should be used when inserting the data into wdb
@@ -168,6 +319,9 @@ namespace wdb { namespace load { namespace point {
         // CDMReader for data that will be interpolated
         boost::shared_ptr<MetNoFimex::CDMReader> cdmData_;
 
+        // metadata of the variables in cdmData_, built after interpolation
+        CDMIndex index_;
+
         // the values from time axis as strings
         vector<string> times_;
         const vector<string>& times() { return times_;}
@@ -188,6 +342,31 @@ namespace wdb { namespace load { namespace point {
 
         // the list of parameters (and metadata) to be extracted
         map<string, EntryToLoad> entries2Load_;
+
+        // values of the entry being written, in output order (kept to reuse the memory),
+        // in double or in single precision (--precision=float)
+        StagedEntry staged_;
+        StagedEntryFloat stagedFloat_;
+        // values read for more than one entry of the current file
+        ReadCache<double> readCache_;
+        ReadCache<float> readCacheFloat_;
+        size_t readCachePeakBytes_;
+        size_t slabReadBytes_;
+        // most bytes held by a slab being read and staged, for the current file
+        size_t peakBytes_;
+        // time slices read through fimex for the current file, and those
+        // of them read again for slabs past the first (see readSlab)
+        size_t sliceReads_;
+        size_t repeatedSliceReads_;
+        // vertical axes of the current file, read at their first entry
+        map<string, boost::shared_array<double> > levelAxes_;
+        map<string, size_t> levelAxisReads_;
+
+        // domain variables of the current file (see markDomainCDM)
+        boost::shared_ptr<DomainCDMReader> domain_;
+        // stations inside each grid definition met so far, by DomainCDMReader::gridKey
+        map<string, vector<size_t> > activeStations_;
+        vector<size_t> allStations_;
     };
 
 
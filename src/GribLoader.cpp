@@ -175,15 +175,12 @@ namespace wdb { namespace load { namespace point {
         return true;
     }
 
-    void GribLoader::loadInterpolated(const string& fileName)
+    void GribLoader::findEntries(const string& fileName)
     {
         WDB_LOG & log = WDB_LOG::getInstance( "wdb.pointload.GribLoader" );
 
         GribFile file(fileName);
 
-        if(times_.size() == 0)
-            return;
-
         // Get first field, and check if it exists
         GribFile::Field gribField = file.next();
         if(!gribField) {
@@ -231,12 +228,6 @@ namespace wdb { namespace load { namespace point {
                 log.errorStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "] " << e.what() << " Data field not loaded.";
             }
         }
-
-        // iterate EntryToLoad vector and build data lines
-        loadEntries();
-
-        // same as loadEntries() but for wind_spee and wind direction
-        loadWindEntries();
     }
 
     string GribLoader::dataProviderName(const GribField & field) const
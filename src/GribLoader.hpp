@@ -56,7 +56,7 @@ namespace wdb { namespace load { namespace point {
         bool openCDM(const string& fileName);
 
         // iterate input file and gather metadata about entries to be loaded
-        void loadInterpolated(const string& fileName);
+        void findEntries(const string& fileName);
 
         // read config files to see grib -> wdb mapping
         int editionNumber(const GribField & field) const;
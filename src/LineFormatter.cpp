@@ -0,0 +1,126 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "LineFormatter.hpp"
+
+// std
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+    const size_t LineFormatter::maxValueLength;
+    const size_t LineFormatter::maxIntegerLength;
+    const size_t LineFormatter::lineReserve;
+
+    LineFormatter::LineFormatter(size_t capacity)
+        : buffer_(capacity < lineReserve ? lineReserve : capacity), used_(0), levelLength_(0), versionLength_(0)
+    { }
+
+    void LineFormatter::setReferenceTime(const string& referenceTime)
+    {
+        referenceTime_ = "\t" + referenceTime + "\t";
+    }
+
+    void LineFormatter::setValidTimes(const vector<string>& validTimes)
+    {
+        validTimes_.resize(validTimes.size());
+        for(size_t u = 0; u < validTimes.size(); ++u)
+            validTimes_[u] = validTimes[u] + "\t" + validTimes[u];
+    }
+
+    void LineFormatter::setParameter(const string& parameter, const string& levelName)
+    {
+        parameter_ = "\t" + parameter + "\t" + levelName + "\t";
+    }
+
+    void LineFormatter::setLevel(size_t level)
+    {
+        size_t length = formatInteger(level_, level);
+        level_[length] = '\t';
+        memcpy(level_ + length + 1, level_, length + 1);
+        levelLength_ = 2 * (length + 1);
+    }
+
+    void LineFormatter::setVersion(int version, size_t maxVersion)
+    {
+        size_t length = 0;
+        if(version < 0)
+            version_[length++] = '-';
+        length += formatInteger(version_ + length, version < 0 ? -static_cast<unsigned long>(version) : version);
+        version_[length++] = '\t';
+        length += formatInteger(version_ + length, maxVersion);
+        version_[length++] = '\n';
+        versionLength_ = length;
+    }
+
+    void LineFormatter::put(const char* str, size_t length)
+    {
+        memcpy(&buffer_[used_], str, length);
+        used_ += length;
+    }
+
+    size_t LineFormatter::formatValue(char* out, double value)
+    {
+        // integral values below 10^6 print as plain integers in %g
+        if(value > -1e6 && value < 1e6 && value == floor(value) && !(value == 0 && signbit(value))) {
+            long v = static_cast<long>(value);
+            if(v < 0) {
+                out[0] = '-';
+                return 1 + formatInteger(out + 1, -v);
+            }
+            return formatInteger(out, v);
+        }
+        // same conversion std::ostream uses for its default float format
+        int length = snprintf(out, maxValueLength, "%g", value);
+        return length < 0 ? 0 : static_cast<size_t>(length);
+    }
+
+    size_t LineFormatter::formatInteger(char* out, unsigned long value)
+    {
+        char digits[maxIntegerLength];
+        size_t n = 0;
+        do {
+            digits[n++] = '0' + (value % 10);
+            value /= 10;
+        } while(value != 0);
+        size_t length = 0;
+        while(n > 0)
+            out[length++] = digits[--n];
+        return length;
+    }
+
+} } } // end namespaces
@@ -0,0 +1,133 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef LINEFORMATTER_HPP
+#define LINEFORMATTER_HPP
+
+// boost
+#include <boost/noncopyable.hpp>
+
+// std
+#include <string>
+#include <vector>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Formats wdb-fastload data lines into a reusable char buffer.
+      *
+      * Everything but the value and the station position is rendered
+      * once (per file, entry, level or ensemble member) and copied into
+      * the buffer with memcpy, so that formatting a line allocates nothing;
+      * levels and members are rendered into fixed buffers, as they change
+      * for every station block.
+      *
+      * The line layout is:
+      * value wkt referencetime validfrom validto parameter levelname levelfrom levelto version maxversion
+      */
+    class LineFormatter : boost::noncopyable
+    {
+    public:
+        /// @param capacity buffer size in bytes; the buffer is full() when less than a line's worth is left
+        explicit LineFormatter(size_t capacity = 1 << 16);
+
+        void setReferenceTime(const std::string& referenceTime);
+        void setValidTimes(const std::vector<std::string>& validTimes);
+        void setParameter(const std::string& parameter, const std::string& levelName);
+        void setLevel(size_t level);
+        void setVersion(int version, size_t maxVersion);
+
+        /// Add one line for value at the given station position and time index
+        void append(double value, const char* wkt, size_t wktLength, size_t time)
+        {
+            const std::string& validTime = validTimes_[time];
+            reserve(maxValueLength + wktLength + referenceTime_.size() + validTime.size() +
+                    parameter_.size() + levelLength_ + versionLength_);
+            used_ += formatValue(&buffer_[used_], value);
+            put('\t');
+            put(wkt, wktLength);
+            put(referenceTime_);
+            put(validTime);
+            put(parameter_);
+            put(level_, levelLength_);
+            put(version_, versionLength_);
+        }
+        void append(double value, const std::string& wkt, size_t time) { append(value, wkt.data(), wkt.size(), time); }
+
+        const char* data() const { return &buffer_[0]; }
+        size_t size() const { return used_; }
+        bool empty() const { return used_ == 0; }
+        /// True when the content should be written out before more lines are added
+        bool full() const { return used_ + lineReserve > buffer_.size(); }
+        void clear() { used_ = 0; }
+
+        /**
+         * Write value into out, the same way std::ostream does
+         * with default flags and precision (%g, 6 significant digits),
+         * returning the number of characters written (at most maxValueLength).
+         */
+        static size_t formatValue(char* out, double value);
+
+        /// Longest text formatValue can produce
+        static const size_t maxValueLength = 32;
+
+        /// Write value in decimal into out, returning the number of characters written (at most maxIntegerLength)
+        static size_t formatInteger(char* out, unsigned long value);
+
+        /// Longest text formatInteger can produce
+        static const size_t maxIntegerLength = 20;
+
+    private:
+        // typical line length kept free when deciding if the buffer is full()
+        static const size_t lineReserve = 512;
+
+        void reserve(size_t length)
+        {
+            if(used_ + length > buffer_.size())
+                buffer_.resize(used_ + length);
+        }
+        void put(char c) { buffer_[used_++] = c; }
+        void put(const char* str, size_t length);
+        void put(const std::string& str) { put(str.data(), str.size()); }
+
+        std::vector<char> buffer_;
+        size_t used_;
+
+        // pre-rendered fragments, separators included
+        std::string referenceTime_;             // "\treference\t"
+        std::vector<std::string> validTimes_;   // "valid\tvalid"
+        std::string parameter_;                 // "\tparameter\tlevelname\t"
+        char level_[2 * maxIntegerLength + 2];  // "level\tlevel\t"
+        size_t levelLength_;
+        char version_[2 * maxIntegerLength + 3]; // "version\tmaxversion\n", version may be negative
+        size_t versionLength_;
+    };
+
+} } } // end namespaces
+
+#endif // LINEFORMATTER_HPP
@@ -33,6 +33,7 @@
 // project
 #include "Loader.hpp"
 #include "FileLoader.hpp"
+#include "ShardedWriter.hpp"
 
 // libfimex
 #include <fimex/CDM.h>
@@ -57,9 +58,11 @@
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/path.hpp>
 #include <boost/assign/list_of.hpp>
+#include <boost/lexical_cast.hpp>
 
 // std
 #include <string>
+#include <sstream>
 #include <vector>
 #include <iostream>
 
@@ -92,15 +95,55 @@ const std::map<std::string, int> interpolationNames = boost::assign::map_list_of
         	throw std::runtime_error("Unknown interpolate.method: " + options().loading().fimexInterpolateMethod);
         interpolateMethod_ = find->second;
 
-        if ( !options().output().outFileName.empty() ) {
-            output_.open(options().output().outFileName);
+        const CmdLine::OutputOptions& out = options().output();
+        if ( writesNetCDF() ) {
+            // fimex writes the files itself, one per input file
+            if ( out.outFileName.empty() )
+                throw std::runtime_error("output.format netcdf requires an output file name");
+            if ( out.shards > 1 )
+                throw std::runtime_error("output.shards can not be used with output.format netcdf");
+            return;
         }
+
+        size_t shards = max<size_t>(1, out.shards);
+        if ( shards > 1 && out.outFileName.empty() )
+            throw std::runtime_error("output.shards requires an output file name");
+
+        OutputWriter::FlushPoint policy = OutputWriter::flushPolicy(out.flushPolicy);
+        boost::shared_ptr<const Compressor> compressor(Compressor::create(out.compress, out.compressLevel));
+        ShardedWriter::Shards pointWriters;
+        for ( size_t s = 0; s < shards; ++s ) {
+            std::ostream* sink = &cout;
+            if ( !out.outFileName.empty() ) {
+                std::string fileName = out.outFileName;
+                if ( shards > 1 )
+                    fileName += "." + boost::lexical_cast<std::string>(s);
+                boost::shared_ptr<output_stream> file(new output_stream(fileName));
+                outputs_.push_back(file);
+                sink = file.get();
+            }
+            boost::shared_ptr<OutputWriter> writer(new OutputWriter(*sink, out.bufferSize, policy, out.queueLength,
+                                                                    compressor, out.compressThreads));
+            writers_.push_back(writer);
+            pointWriters.push_back(boost::shared_ptr<PointWriter>(PointWriterFactory::createPointWriter(out.format, *this, *writer)));
+        }
+        if ( shards > 1 )
+            pointWriter_ = boost::shared_ptr<PointWriter>(new ShardedWriter(ShardedWriter::shardKey(out.shardKey), *this, pointWriters));
+        else
+            pointWriter_ = pointWriters.front();
     }
 
     Loader::~Loader()
     {
-        if(output_.is_open()) {
-            output_.close();
+        try {
+            close();
+        } catch (std::exception& e) {
+            WDB_LOG & log = WDB_LOG::getInstance( "wdb.pointLoad.Loader" );
+            log.errorStream() << "Unable to write output: " << e.what();
+        }
+        for ( size_t s = 0; s < outputs_.size(); ++s ) {
+            if ( outputs_[s]->is_open() )
+                outputs_[s]->close();
         }
     }
 
@@ -131,7 +174,15 @@ const std::map<std::string, int> interpolationNames = boost::assign::map_list_of
                 continue;
             }
             try {
-                floader_->load(gridded);
+                if ( writesNetCDF() ) {
+                    string outFileName = options().output().outFileName;
+                    if ( filenames.size() > 1 )
+                        outFileName += "." + boost::lexical_cast<std::string>(i);
+                    floader_->writeNetCDF(gridded, outFileName);
+                } else {
+                    floader_->load(gridded);
+                    flush(OutputWriter::FlushFile);
+                }
             } catch (MetNoFimex::CDMException& e) {
                 log.errorStream() << "Unable to load file [" << gridded << "]";
                 throw e;
@@ -140,6 +191,22 @@ const std::map<std::string, int> interpolationNames = boost::assign::map_list_of
                 throw e;
             }
         }
+
+        if ( pointWriter_ )
+            pointWriter_->close();
+        close();
+        for ( size_t s = 0; s < writers_.size(); ++s ) {
+            const OutputWriter& writer = *writers_[s];
+            stringstream name;
+            name << "Output";
+            if ( writers_.size() > 1 )
+                name << " shard " << s;
+            log.infoStream() << name.str() << ": " << writer.bytes() << " bytes (" << writer.written() << " written) in "
+                             << writer.writes() << " writes, " << writer.flushes() << " flushes, "
+                             << writer.stalls() << " waits for the writer thread";
+        }
+        if ( floader_ )
+            log.infoStream() << "Reads: " << floader_->decodedReads() << " decoded, " << floader_->cachedReads() << " shared through the read cache";
     }
 
 //    We are using fimex and the process of template interpolation to extract point related data.
@@ -196,18 +263,66 @@ const std::map<std::string, int> interpolationNames = boost::assign::map_list_of
         for(; fsIt!=feIt; ++fsIt)
             longitudes_.push_back(*fsIt);
 
+        if(latitudes_.size() != longitudes_.size())
+            return false;
+
+        // the WKT for each station is the same for every value
+        // written during the run, so render it only once
+        wkts_.clear();
+        wkts_.reserve(latitudes_.size());
+        for(size_t i = 0; i < latitudes_.size(); ++i) {
+            stringstream wkt;
+            wkt << "point" << "(" << longitudes_[i] << " " << latitudes_[i] << ")";
+            wkts_.push_back(wkt.str());
+        }
+
         return true;
     }
 
-    // Writes either to standard output or to a file-
-    void Loader::write(const string &str)
+    const map<string, size_t>& Loader::levelAxisReads() const
     {
-        if(output_.is_open()) {
-            output_ << str;
-            flush(output_);
-        } else {
-            cout << str;
-        }
+        static const map<string, size_t> none;
+        return floader_ ? floader_->levelAxisReads() : none;
+    }
+
+    const map<string, vector<size_t> >& Loader::activeStations() const
+    {
+        static const map<string, vector<size_t> > none;
+        return floader_ ? floader_->activeStations() : none;
+    }
+
+    size_t Loader::peakBytes() const
+    {
+        return floader_ ? floader_->peakBytes() : 0;
+    }
+
+    size_t Loader::repeatedSliceReads() const
+    {
+        return floader_ ? floader_->repeatedSliceReads() : 0;
+    }
+
+    size_t Loader::readCachePeakBytes() const
+    {
+        return floader_ ? floader_->readCachePeakBytes() : 0;
+    }
+
+    size_t Loader::slabReadBytes() const
+    {
+        return floader_ ? floader_->slabReadBytes() : 0;
+    }
+
+    // Marks a flush point on each output writer (one per shard); a writer
+    // flushes its stream there only if --output.flush allows it
+    void Loader::flush(OutputWriter::FlushPoint point)
+    {
+        for ( size_t s = 0; s < writers_.size(); ++s )
+            writers_[s]->flush(point);
+    }
+
+    void Loader::close()
+    {
+        for ( size_t s = 0; s < writers_.size(); ++s )
+            writers_[s]->close();
     }
 
 } } } // end namespaces
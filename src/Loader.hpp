@@ -31,6 +31,8 @@
 
 // project
 #include "CmdLine.hpp"
+#include "OutputWriter.hpp"
+#include "PointWriter.hpp"
 
 // libfimex
 #include <fimex/CDMInterpolator.h>
@@ -42,6 +44,7 @@
 #include <boost/iostreams/device/file.hpp>
 
 // std
+#include <map>
 #include <set>
 #include <vector>
 #include <string>
@@ -76,11 +79,30 @@ namespace wdb { namespace load { namespace point {
 
         const vector<float>& latitudes() { return latitudes_; }
         const vector<float>& longitudes() { return longitudes_; }
+        // station positions rendered once as "point(lon lat)"
+        const vector<string>& wkts() { return wkts_; }
         const size_t interpolatemethod() { return interpolateMethod_; }
 
-        // Writes point data lines either to standard output
-        // or to a deticated output file
-        void write(const string& str);
+        // Marks a point where output may be flushed (see --output.flush)
+        void flush(OutputWriter::FlushPoint point);
+
+        // Writer for the extracted values in the format given by --output.format
+        PointWriter& pointWriter() { return *pointWriter_; }
+
+        // Files are written as station NetCDF by fimex instead of through pointWriter()
+        bool writesNetCDF() const { return options_.output().format == "netcdf"; }
+
+        // Reads of each vertical axis by the file loader (see FileLoader::levelAxisReads)
+        const map<string, size_t>& levelAxisReads() const;
+        // Template stations inside each grid met by the file loader (see FileLoader::activeStations)
+        const map<string, vector<size_t> >& activeStations() const;
+        // Estimated peak slab memory of the last file loaded (see FileLoader::peakBytes)
+        size_t peakBytes() const;
+        // Time slices of the last file read again for further slabs (see FileLoader::repeatedSliceReads)
+        size_t repeatedSliceReads() const;
+        // Most bytes held by the read cache, and by the reads of one slab (see FileLoader::readCachePeakBytes)
+        size_t readCachePeakBytes() const;
+        size_t slabReadBytes() const;
     private:
 
         // Create CDMReader for the template file (in netcdf format)
@@ -103,12 +125,22 @@ namespace wdb { namespace load { namespace point {
         // point ids found in cdm template
         vector<float>                     latitudes_;
         vector<float>                     longitudes_;
+        vector<string>                    wkts_;
 
         // Pointer to a specialized loader object
         // ATM there are 3 types: FELT/GRIB/NETCDF
         boost::shared_ptr<FileLoader>   floader_;
 
-        output_stream output_;
+        // Writes and closes the buffered output of all shards
+        void close();
+
+        // Output files; one per shard (--output.shards), none for standard output
+        vector<boost::shared_ptr<output_stream> > outputs_;
+
+        // Buffers everything sent to the matching output file (or standard output)
+        vector<boost::shared_ptr<OutputWriter> > writers_;
+
+        boost::shared_ptr<PointWriter> pointWriter_;
     };
 
 } } } // end namespaces
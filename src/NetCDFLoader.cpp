@@ -141,7 +141,8 @@ namespace wdb { namespace load { namespace point {
 
     string NetCDFLoader::valueParameterUnit(const string& varname)
     {
-        return cdmData_->getCDM().getUnits(varname);
+        const CDMIndex::Variable* variable = index_.variable(varname);
+        return variable ? variable->units : cdmData_->getCDM().getUnits(varname);
     }
 
     string NetCDFLoader::valueParameterName(const string& varname)
@@ -158,8 +159,8 @@ namespace wdb { namespace load { namespace point {
     void NetCDFLoader::levelValues(vector<Level> & levels, const string& varname)
     {
         WDB_LOG & log = WDB_LOG::getInstance( "wdb.pointload.NetCDFLoader" );
-        const CDM& cdmRef = cdmData_->getCDM();
-        string verticalCoordinate = cdmRef.getVerticalAxis(varname);
+        const CDMIndex::Variable* variable = index_.variable(varname);
+        string verticalCoordinate = variable ? variable->verticalAxis : cdmData_->getCDM().getVerticalAxis(varname);
 	if(verticalCoordinate.empty())
 	  throw wdb::ignore_value( "No vertical coordinate found for " + varname);
         string levelParameter;
@@ -223,25 +224,19 @@ namespace wdb { namespace load { namespace point {
         }
     }
 
-    void NetCDFLoader::loadInterpolated(const string& fileName)
+    void NetCDFLoader::findEntries(const string& fileName)
     {
         WDB_LOG & log = WDB_LOG::getInstance( "wdb.pointload.NetCDFLoader" );
-        if(times_.size() == 0)
-            return;
 
-        const CDM& cdmRef = cdmData_->getCDM();
-        vector<CDMVariable> variables = cdmRef.getVariables();
+        const vector<CDMIndex::Variable>& variables = index_.variables();
 
         for(size_t i = 0; i < variables.size(); ++i)
         {
             try{
                 std::map<std::string, EntryToLoad>::iterator eIt;
 
-                CDMVariable variable = variables[i];
-                string varname = variable.getName();
-                CDMAttribute uAtt;
-                cdmRef.getAttribute(varname, "standard_name", uAtt);
-                string standardname = uAtt.getStringValue();
+                const string& varname = variables[i].name;
+                const string& standardname = variables[i].standardName;
                 string wdbname = valueParameterName(varname);
                 string wdbunit = valueParameterUnit(varname);
                 string wdbdataprovider = dataProviderName(varname);
@@ -272,11 +267,5 @@ namespace wdb { namespace load { namespace point {
                 log.debugStream() <<__FUNCTION__<< " @ line["<< __LINE__ << "] " << e.what() << " Data field not loaded.";
             }
         }
-
-        // load regualar parameters
-        loadEntries();
-
-        // load calculated wind_speed and wind_direction
-        loadWindEntries();
     }
 } } } // namespaces
@@ -35,7 +35,7 @@ namespace wdb { namespace load { namespace point {
         bool openCDM(const string& fileName);
 
         // iterate input file and gather parameters to be loaded
-        void loadInterpolated(const string& fileName);
+        void findEntries(const string& fileName);
 
         // get the metadata values from config files - for each parameter
         ////////////////////////////////////////////////////////////////////////////////
@@ -0,0 +1,339 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "OutputWriter.hpp"
+
+// boost
+#include <boost/bind.hpp>
+#include <boost/assign/list_of.hpp>
+
+// std
+#include <map>
+#include <cstring>
+#include <ostream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+namespace
+{
+const std::map<std::string, OutputWriter::FlushPoint> flushPolicyNames = boost::assign::map_list_of
+        ("line", OutputWriter::FlushLine)
+        ("dataprovider", OutputWriter::FlushDataProvider)
+        ("file", OutputWriter::FlushFile)
+        ("never", OutputWriter::FlushNever);
+}
+
+    OutputWriter::OutputWriter(std::ostream& sink, size_t bufferSize, FlushPoint policy, size_t queueLength,
+                               boost::shared_ptr<const Compressor> compressor, size_t compressThreads)
+        : sink_(sink), bufferSize_(bufferSize == 0 ? 1 : bufferSize), used_(0), policy_(policy),
+          compressor_(compressor), bytes_(0), written_(0), writes_(0), flushes_(0), stalls_(0),
+          queueLength_(queueLength), busy_(false), stop_(false)
+    {
+        buffer_.resize(bufferSize_);
+        if(queueLength_ == 0)
+            return;
+
+        if(compressor_.get()) {
+            if(compressThreads == 0)
+                compressThreads = 1;
+            // keep every compression thread busy
+            if(queueLength_ < compressThreads + 1)
+                queueLength_ = compressThreads + 1;
+            for(size_t t = 0; t < compressThreads; ++t)
+                workers_.create_thread(boost::bind(&OutputWriter::compressLoop, this));
+        }
+        thread_ = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&OutputWriter::run, this)));
+    }
+
+    OutputWriter::~OutputWriter()
+    {
+        try {
+            if(used_ > 0)
+                close();
+        } catch (std::exception&) {
+            // NOOP - never throw from destructor
+        }
+
+        if(thread_.get()) {
+            {
+                boost::mutex::scoped_lock lock(mutex_);
+                stop_ = true;
+            }
+            changed_.notify_all();
+            thread_->join();
+            workers_.join_all();
+        }
+    }
+
+    void OutputWriter::write(const char* data, size_t length)
+    {
+        bytes_ += length;
+
+        if(used_ + length > buffer_.size()) {
+            drain();
+            // too large to be buffered - write it in buffer sized pieces
+            while(length >= buffer_.size()) {
+                memcpy(&buffer_[0], data, buffer_.size());
+                used_ = buffer_.size();
+                data += buffer_.size();
+                length -= buffer_.size();
+                drain();
+            }
+        }
+
+        if(length > 0) {
+            memcpy(&buffer_[used_], data, length);
+            used_ += length;
+        }
+
+        if(policy_ == FlushLine)
+            flush(FlushLine);
+    }
+
+    void OutputWriter::flush(FlushPoint point)
+    {
+        if(point < policy_)
+            return;
+        if(thread_.get()) {
+            submit(true);
+        } else {
+            drain();
+            sink_.flush();
+            ++flushes_;
+        }
+    }
+
+    void OutputWriter::close()
+    {
+        if(thread_.get()) {
+            submit(true);
+            wait();
+        } else {
+            drain();
+            sink_.flush();
+            ++flushes_;
+        }
+    }
+
+    size_t OutputWriter::written() const
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        return written_;
+    }
+
+    size_t OutputWriter::writes() const
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        return writes_;
+    }
+
+    size_t OutputWriter::flushes() const
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        return flushes_;
+    }
+
+    size_t OutputWriter::stalls() const
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        return stalls_;
+    }
+
+    void OutputWriter::drain()
+    {
+        if(used_ == 0)
+            return;
+        if(thread_.get()) {
+            submit(false);
+            return;
+        }
+        put(buffer_, used_);
+        ++writes_;
+        used_ = 0;
+        if(!sink_)
+            throw runtime_error("Failed writing to output");
+    }
+
+    void OutputWriter::put(const std::vector<char>& data, size_t used)
+    {
+        if(compressor_.get()) {
+            compressor_->compress(&data[0], used, packed_);
+            sink_.write(&packed_[0], packed_.size());
+            written_ += packed_.size();
+        } else {
+            sink_.write(&data[0], used);
+            written_ += used;
+        }
+    }
+
+    void OutputWriter::submit(bool flush)
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        if(pending_.size() >= queueLength_)
+            ++stalls_;
+        while(pending_.size() >= queueLength_ && error_.empty())
+            changed_.wait(lock);
+        if(!error_.empty())
+            throw runtime_error(error_);
+
+        pending_.push_back(Block());
+        Block& block = pending_.back();
+        block.data.swap(buffer_);
+        block.used = used_;
+        block.flush = flush;
+        block.state = (compressor_.get() && used_ > 0) ? Block::Filled : Block::Ready;
+        used_ = 0;
+
+        // reuse a buffer already written by the writer thread
+        if(!free_.empty()) {
+            buffer_.swap(free_.back());
+            free_.pop_back();
+        } else {
+            buffer_.resize(bufferSize_);
+        }
+
+        changed_.notify_all();
+    }
+
+    void OutputWriter::wait()
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        while((!pending_.empty() || busy_) && error_.empty())
+            changed_.wait(lock);
+        if(!error_.empty())
+            throw runtime_error(error_);
+    }
+
+    void OutputWriter::run()
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        for(;;) {
+            // blocks are written strictly in order, waiting for compression if needed
+            while((pending_.empty() || pending_.front().state != Block::Ready) && !(stop_ && pending_.empty()))
+                changed_.wait(lock);
+            if(pending_.empty())
+                return;
+
+            Block block;
+            block.data.swap(pending_.front().data);
+            block.packed.swap(pending_.front().packed);
+            block.used = pending_.front().used;
+            block.flush = pending_.front().flush;
+            pending_.pop_front();
+            busy_ = true;
+            // nothing more is written once something failed
+            bool skip = !error_.empty();
+
+            lock.unlock();
+            bool failed = false;
+            size_t written = 0;
+            if(block.used > 0 && !skip) {
+                if(compressor_.get()) {
+                    sink_.write(&block.packed[0], block.packed.size());
+                    written = block.packed.size();
+                } else {
+                    sink_.write(&block.data[0], block.used);
+                    written = block.used;
+                }
+            }
+            if(block.flush)
+                sink_.flush();
+            if(!sink_)
+                failed = true;
+            lock.lock();
+
+            if(block.used > 0)
+                ++writes_;
+            if(block.flush)
+                ++flushes_;
+            written_ += written;
+            if(failed && error_.empty())
+                error_ = "Failed writing to output";
+            free_.push_back(std::vector<char>());
+            free_.back().swap(block.data);
+            busy_ = false;
+            changed_.notify_all();
+        }
+    }
+
+    void OutputWriter::compressLoop()
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        for(;;) {
+            // the oldest block still waiting for compression
+            Block* block = 0;
+            for(;;) {
+                for(std::deque<Block>::iterator it = pending_.begin(); it != pending_.end(); ++it) {
+                    if(it->state == Block::Filled) {
+                        block = &*it;
+                        break;
+                    }
+                }
+                if(block != 0 || stop_)
+                    break;
+                changed_.wait(lock);
+            }
+            if(block == 0)
+                return;
+
+            // the writer thread leaves the block alone until it is Ready,
+            // and deque::push_back keeps references to other elements valid
+            block->state = Block::Compressing;
+            lock.unlock();
+            string error;
+            try {
+                compressor_->compress(&block->data[0], block->used, block->packed);
+            } catch (std::exception& e) {
+                error = e.what();
+            }
+            lock.lock();
+
+            block->state = Block::Ready;
+            if(!error.empty() && error_.empty())
+                error_ = error;
+            changed_.notify_all();
+        }
+    }
+
+    OutputWriter::FlushPoint OutputWriter::flushPolicy(const std::string& name)
+    {
+        std::map<std::string, FlushPoint>::const_iterator find = flushPolicyNames.find(name);
+        if(find == flushPolicyNames.end())
+            throw std::runtime_error("Unknown output.flush policy: " + name);
+        return find->second;
+    }
+
+} } } // end namespaces
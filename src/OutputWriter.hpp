@@ -0,0 +1,173 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef OUTPUTWRITER_HPP
+#define OUTPUTWRITER_HPP
+
+// boost
+#include <boost/noncopyable.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+// project
+#include "Compressor.hpp"
+
+// std
+#include <deque>
+#include <string>
+#include <vector>
+#include <iosfwd>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Buffered writer used for all point data lines.
+      *
+      * Lines are collected in a fixed size buffer that is handed to the
+      * underlying stream only when full. The stream itself is flushed only
+      * at the points allowed by the flush policy.
+      *
+      * With a non-zero queue length, filled buffers are handed to a
+      * dedicated writer thread through a bounded queue, so that the
+      * loader can go on formatting while earlier buffers drain. The
+      * buffers are written in the order they were filled.
+      *
+      * Buffers may also be compressed (see Compressor). With a writer
+      * thread the compression runs on a pool of worker threads, each
+      * buffer on its own, while the writer thread still writes them in
+      * the order they were filled.
+      */
+    class OutputWriter : boost::noncopyable
+    {
+    public:
+        /// Points in the output where a flush may take place, in ascending order
+        enum FlushPoint
+        {
+            FlushLine = 0,      ///< after every data line (the old behaviour)
+            FlushDataProvider,  ///< at the end of each data provider block
+            FlushFile,          ///< at the end of each input file
+            FlushNever          ///< only when the writer is closed
+        };
+
+        /**
+         * @param sink       stream that receives the data
+         * @param bufferSize size of the internal buffer in bytes
+         * @param policy     smallest flush point that triggers a flush
+         * @param queueLength number of filled buffers that may wait for
+         *                   the writer thread; 0 writes on the caller's thread
+         * @param compressor compression of each buffer; none if 0
+         * @param compressThreads number of compression worker threads
+         */
+        OutputWriter(std::ostream& sink, size_t bufferSize, FlushPoint policy, size_t queueLength = 0,
+                     boost::shared_ptr<const Compressor> compressor = boost::shared_ptr<const Compressor>(),
+                     size_t compressThreads = 1);
+        ~OutputWriter();
+
+        /// Append data; each call is expected to hold complete lines
+        void write(const char* data, size_t length);
+        void write(const std::string& str) { write(str.data(), str.size()); }
+
+        /// Mark a flush point. The stream is flushed if policy allows it
+        void flush(FlushPoint point);
+
+        /// Hand all buffered data to the stream and flush it
+        void close();
+
+        /// Bytes accepted by the writer
+        size_t bytes() const { return bytes_; }
+        /// Bytes written to the stream (differs from bytes() when compressing)
+        size_t written() const;
+        /// Number of buffer writes to the underlying stream
+        size_t writes() const;
+        /// Number of stream flushes
+        size_t flushes() const;
+        /// Number of times the loader had to wait for a free buffer
+        size_t stalls() const;
+
+        /// Translate policy name [line/dataprovider/file/never]
+        static FlushPoint flushPolicy(const std::string& name);
+
+    private:
+        // move buffer content to the stream (or the writer queue)
+        void drain();
+
+        // hand the current buffer to the writer thread
+        void submit(bool flush);
+        // wait until the writer thread has emptied the queue
+        void wait();
+        // writer thread main loop
+        void run();
+        // compression worker main loop
+        void compressLoop();
+        // write one buffer (compressed if requested) to the stream
+        void put(const std::vector<char>& data, size_t used);
+
+        struct Block
+        {
+            enum State { Filled, Compressing, Ready };
+
+            std::vector<char> data;
+            size_t used;
+            bool flush;
+            State state;
+            std::vector<char> packed;
+        };
+
+        std::ostream& sink_;
+        std::vector<char> buffer_;
+        size_t bufferSize_;
+        size_t used_;
+        FlushPoint policy_;
+
+        boost::shared_ptr<const Compressor> compressor_;
+        std::vector<char> packed_;
+
+        size_t bytes_;
+        size_t written_;
+        size_t writes_;
+        size_t flushes_;
+        size_t stalls_;
+
+        // writer thread state - guarded by mutex_
+        size_t queueLength_;
+        std::deque<Block> pending_;
+        std::vector<std::vector<char> > free_;
+        bool busy_;
+        bool stop_;
+        std::string error_;
+        mutable boost::mutex mutex_;
+        boost::condition_variable changed_;
+        boost::shared_ptr<boost::thread> thread_;
+        boost::thread_group workers_;
+    };
+
+} } } // end namespaces
+
+#endif // OUTPUTWRITER_HPP
@@ -0,0 +1,73 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "PointWriter.hpp"
+#include "FastloadWriter.hpp"
+#include "BinaryPointWriter.hpp"
+#include "CopyBinaryWriter.hpp"
+#include "ColumnarWriter.hpp"
+
+// std
+#include <sstream>
+#include <stdexcept>
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+    BlockOutput::BlockOutput() : writer_(stream_, 1 << 16, OutputWriter::FlushNever) { }
+
+    string BlockOutput::take()
+    {
+        writer_.close();
+        return stream_.str();
+    }
+
+    PointWriter *PointWriterFactory::createPointWriter(const std::string &format, Loader& controller, OutputWriter& output)
+    {
+        if(format == "text") {
+            return new FastloadWriter(controller, output);
+        } else if(format == "binary") {
+            return new BinaryPointWriter(controller, output);
+        } else if(format == "copy") {
+            return new CopyBinaryWriter(controller, output);
+        } else if(format == "columnar") {
+            return new ColumnarWriter(controller, output);
+        } else {
+            stringstream ss;
+            ss << "Unrecognized output format: " << format;
+            throw runtime_error(ss.str());
+        }
+    }
+
+} } } // end namespaces
@@ -0,0 +1,118 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef POINTWRITER_HPP
+#define POINTWRITER_HPP
+
+// project
+#include "OutputWriter.hpp"
+
+// boost
+#include <boost/noncopyable.hpp>
+
+// std
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace wdb { namespace load { namespace point {
+
+    class Loader;
+
+    /**
+      * Output of a writer made by PointWriter::fork, kept in memory until
+      * the block is joined.
+      */
+    class BlockOutput : boost::noncopyable
+    {
+    public:
+        BlockOutput();
+
+        OutputWriter& writer() { return writer_; }
+        /// Everything written; closes the writer
+        std::string take();
+
+    private:
+        std::ostringstream stream_;
+        OutputWriter writer_;
+    };
+
+    /**
+      * Receives the extracted point values and writes them in some output format.
+      *
+      * The calls follow the loops of FileLoader::loadEntries:
+      * beginEntries, then for each entry beginEntry, setLevel, setVersion
+      * and write for each value, and endEntries when all entries are done.
+      * close is called once, when all input files are loaded.
+      */
+    class PointWriter : boost::noncopyable
+    {
+    public:
+        virtual ~PointWriter() { }
+
+        /// Start of a pass over the entries of a file
+        virtual void beginEntries(const std::string& referenceTime, const std::vector<std::string>& validTimes) = 0;
+        /// Start of a new parameter (the data provider may change between entries)
+        virtual void beginEntry(const std::string& dataProvider, const std::string& parameter, const std::string& levelName) = 0;
+        virtual void setLevel(size_t level) = 0;
+        virtual void setVersion(int version, size_t maxVersion) = 0;
+        /// One value for the station and valid time indexes
+        virtual void write(double value, size_t station, size_t time) = 0;
+        /// End of the pass started with beginEntries
+        virtual void endEntries() = 0;
+        /// End of the output; called once after the last file
+        virtual void close() { }
+
+        /**
+         * A writer for a block of stations of the current entry, so that
+         * blocks can be written in parallel. It takes the setLevel,
+         * setVersion and write calls for its stations and keeps the output
+         * in memory. Returns 0 when the format can only be written serially.
+         */
+        virtual PointWriter* fork() { return 0; }
+        /// Append the output of a block made by fork; blocks are joined in station order
+        virtual void join(PointWriter& block) { }
+
+        /**
+         * True when the writer needs the setLevel and setVersion calls of
+         * every station, also of those with no values at all; otherwise
+         * stations outside the data domain are not passed on.
+         */
+        virtual bool everyStation() const { return false; }
+    };
+
+    // helper factory class - creates writer for --output.format
+    class PointWriterFactory
+    {
+    public:
+        static PointWriter *createPointWriter(const std::string &format, Loader& controller, OutputWriter& output);
+    };
+
+} } } // end namespaces
+
+#endif // POINTWRITER_HPP
@@ -0,0 +1,153 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "ReadCache.hpp"
+
+// std
+#include <algorithm>
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+    template<typename T>
+    ReadCache<T>::ReadCache() : capacity_(0), bytes_(0), peakBytes_(0), hits_(0), misses_(0) { }
+
+    template<typename T>
+    void ReadCache<T>::plan(const string& key)
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        ++reads_[key].uses;
+    }
+
+    template<typename T>
+    bool ReadCache<T>::take(const string& key, boost::shared_array<T>& values, size_t& size)
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        typename map<string, Read>::iterator read = reads_.find(key);
+        if(read == reads_.end() || !read->second.values) {
+            ++misses_;
+            if(read != reads_.end() && read->second.uses > 0)
+                --read->second.uses;
+            return false;
+        }
+
+        ++hits_;
+        values = read->second.values;
+        size = read->second.size;
+        if(read->second.uses > 0)
+            --read->second.uses;
+        if(read->second.uses == 0) {
+            bytes_ -= size * sizeof(T);
+            reads_.erase(read);
+        }
+        return true;
+    }
+
+    template<typename T>
+    void ReadCache<T>::keep(const string& key, const boost::shared_array<T>& values, size_t size)
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        typename map<string, Read>::iterator read = reads_.find(key);
+        if(read == reads_.end())
+            return;
+        if(read->second.uses == 0) {
+            reads_.erase(read);
+            return;
+        }
+        if(read->second.values || (capacity_ > 0 && bytes_ + size * sizeof(T) > capacity_))
+            return;
+
+        read->second.values = values;
+        read->second.size = size;
+        bytes_ += size * sizeof(T);
+        peakBytes_ = max(peakBytes_, bytes_);
+    }
+
+    template<typename T>
+    bool ReadCache<T>::wants(const string& key, size_t size) const
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        typename map<string, Read>::const_iterator read = reads_.find(key);
+        return read != reads_.end() && read->second.uses > 0 && !read->second.values
+            && (capacity_ == 0 || bytes_ + size * sizeof(T) <= capacity_);
+    }
+
+    template<typename T>
+    void ReadCache<T>::setCapacity(size_t bytes)
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        capacity_ = bytes;
+    }
+
+    template<typename T>
+    void ReadCache<T>::clear()
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        reads_.clear();
+        bytes_ = 0;
+        peakBytes_ = 0;
+    }
+
+    template<typename T>
+    size_t ReadCache<T>::bytes() const
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        return bytes_;
+    }
+
+    template<typename T>
+    size_t ReadCache<T>::peakBytes() const
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        return peakBytes_;
+    }
+
+    template<typename T>
+    size_t ReadCache<T>::hits() const
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        return hits_;
+    }
+
+    template<typename T>
+    size_t ReadCache<T>::misses() const
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        return misses_;
+    }
+
+    template class ReadCache<double>;
+    template class ReadCache<float>;
+
+} } } // end namespaces
@@ -0,0 +1,118 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef READCACHE_HPP
+#define READCACHE_HPP
+
+// boost
+#include <boost/noncopyable.hpp>
+#include <boost/shared_array.hpp>
+#include <boost/thread/mutex.hpp>
+
+// std
+#include <map>
+#include <string>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Values read from a file that more than one planned read asks for.
+      *
+      * Several entries may read the same variable in the same unit and
+      * for the same stations and levels (entries mapped to one variable,
+      * or wind speed and direction reading the same components). Each
+      * read is planned first, so the cache knows how many times a key
+      * will be asked for: the values of the first read are kept for the
+      * later ones and dropped at the last, instead of being decoded and
+      * interpolated again.
+      *
+      * The cache is filled on the prefetch thread (see SlabPrefetcher)
+      * while the loader thread asks for its size, so it is guarded by
+      * a mutex.
+      *
+      * T is double or float (--precision); both are instantiated in
+      * ReadCache.cpp.
+      */
+    template<typename T>
+    class ReadCache : boost::noncopyable
+    {
+    public:
+        ReadCache();
+
+        /// Count a planned read of key
+        void plan(const std::string& key);
+
+        /**
+         * Ask for the values of key, as one of its planned reads: true
+         * (a hit) when they are kept; the values are dropped at the last
+         * planned read
+         */
+        bool take(const std::string& key, boost::shared_array<T>& values, size_t& size);
+
+        /// Keep the values just read for key, if more planned reads ask for them and they fit
+        void keep(const std::string& key, const boost::shared_array<T>& values, size_t size);
+
+        /// True when keep would keep size values for key
+        bool wants(const std::string& key, size_t size) const;
+
+        /// Most bytes kept at a time, 0 for no limit
+        void setCapacity(size_t bytes);
+
+        /// Forget the planned reads and kept values (hits and misses are kept)
+        void clear();
+
+        /// Bytes of the values kept
+        size_t bytes() const;
+        /// Most bytes kept at a time since the last clear
+        size_t peakBytes() const;
+        /// Reads answered from the cache
+        size_t hits() const;
+        /// Reads that had to be done
+        size_t misses() const;
+
+    private:
+        struct Read
+        {
+            Read() : uses(0), size(0) { }
+            size_t uses;        // planned reads still to come
+            boost::shared_array<T> values;
+            size_t size;
+        };
+
+        std::map<std::string, Read> reads_;
+        size_t capacity_;
+        size_t bytes_;
+        size_t peakBytes_;
+        size_t hits_;
+        size_t misses_;
+        mutable boost::mutex mutex_;
+    };
+
+} } } // end namespaces
+
+#endif // READCACHE_HPP
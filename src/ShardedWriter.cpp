@@ -0,0 +1,147 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "ShardedWriter.hpp"
+#include "Loader.hpp"
+
+// boost
+#include <boost/assign/list_of.hpp>
+
+// std
+#include <stdexcept>
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+    static const map<string, ShardedWriter::Key> shardKeys = boost::assign::map_list_of
+            ("station", ShardedWriter::StationBlock)
+            ("parameter", ShardedWriter::Parameter)
+            ("time", ShardedWriter::ValidTime);
+
+    ShardedWriter::ShardedWriter(Key key, Loader& controller, const Shards& shards)
+        : key_(key), controller_(controller), shards_(shards), blockSize_(1), active_(0)
+    {
+        if(shards_.empty())
+            throw runtime_error("No output shards");
+    }
+
+    ShardedWriter::ShardedWriter(const ShardedWriter& parent, const Shards& blocks)
+        : key_(parent.key_), controller_(parent.controller_), shards_(blocks), blockSize_(parent.blockSize_), active_(parent.active_)
+    { }
+
+    ShardedWriter::~ShardedWriter() { }
+
+    ShardedWriter::Key ShardedWriter::shardKey(const string& name)
+    {
+        map<string, Key>::const_iterator find = shardKeys.find(name);
+        if(find == shardKeys.end())
+            throw runtime_error("Unknown output.shard.key: " + name);
+        return find->second;
+    }
+
+    void ShardedWriter::beginEntries(const string& referenceTime, const vector<string>& validTimes)
+    {
+        size_t blocked = key_ == ValidTime ? validTimes.size() : controller_.wkts().size();
+        blockSize_ = max<size_t>(1, (blocked + shards_.size() - 1) / shards_.size());
+        for(size_t s = 0; s < shards_.size(); ++s)
+            shards_[s]->beginEntries(referenceTime, validTimes);
+    }
+
+    void ShardedWriter::beginEntry(const string& dataProvider, const string& parameter, const string& levelName)
+    {
+        if(key_ == Parameter) {
+            map<string, size_t>::const_iterator find = parameterShards_.find(parameter);
+            if(find == parameterShards_.end()) {
+                size_t shard = parameterShards_.size() % shards_.size();
+                find = parameterShards_.insert(make_pair(parameter, shard)).first;
+            }
+            active_ = find->second;
+        }
+        for(size_t s = first(); s < last(); ++s)
+            shards_[s]->beginEntry(dataProvider, parameter, levelName);
+    }
+
+    void ShardedWriter::setLevel(size_t level)
+    {
+        for(size_t s = first(); s < last(); ++s)
+            shards_[s]->setLevel(level);
+    }
+
+    void ShardedWriter::setVersion(int version, size_t maxVersion)
+    {
+        for(size_t s = first(); s < last(); ++s)
+            shards_[s]->setVersion(version, maxVersion);
+    }
+
+    void ShardedWriter::endEntries()
+    {
+        for(size_t s = 0; s < shards_.size(); ++s)
+            shards_[s]->endEntries();
+    }
+
+    void ShardedWriter::close()
+    {
+        for(size_t s = 0; s < shards_.size(); ++s)
+            shards_[s]->close();
+    }
+
+    PointWriter* ShardedWriter::fork()
+    {
+        Shards blocks;
+        for(size_t s = 0; s < shards_.size(); ++s) {
+            PointWriter* block = shards_[s]->fork();
+            if(block == 0)
+                return 0;
+            blocks.push_back(boost::shared_ptr<PointWriter>(block));
+        }
+        return new ShardedWriter(*this, blocks);
+    }
+
+    void ShardedWriter::join(PointWriter& block)
+    {
+        ShardedWriter& blocks = static_cast<ShardedWriter&>(block);
+        for(size_t s = 0; s < shards_.size(); ++s)
+            shards_[s]->join(*blocks.shards_[s]);
+    }
+
+    bool ShardedWriter::everyStation() const
+    {
+        for(size_t s = 0; s < shards_.size(); ++s) {
+            if(shards_[s]->everyStation())
+                return true;
+        }
+        return false;
+    }
+
+} } } // end namespaces
@@ -0,0 +1,117 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef SHARDEDWRITER_HPP
+#define SHARDEDWRITER_HPP
+
+// project
+#include "PointWriter.hpp"
+
+// boost
+#include <boost/shared_ptr.hpp>
+
+// std
+#include <map>
+#include <string>
+#include <vector>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Splits the values between several writers (--output.shards), so that
+      * downstream loaders can ingest the files in parallel.
+      *
+      * Every shard is a complete stream in the chosen format: it gets the
+      * same beginEntries/beginEntry/endEntries calls as a single writer
+      * would (for the parameter key only the shard owning the entry does),
+      * while each value goes to exactly one shard. The key decides which:
+      *
+      *  station   - contiguous blocks of stations
+      *  parameter - whole entries, shards assigned round robin by first appearance
+      *  time      - contiguous blocks of valid times
+      */
+    class ShardedWriter : public PointWriter
+    {
+    public:
+        enum Key
+        {
+            StationBlock,
+            Parameter,
+            ValidTime
+        };
+
+        typedef std::vector<boost::shared_ptr<PointWriter> > Shards;
+
+        ShardedWriter(Key key, Loader& controller, const Shards& shards);
+        ~ShardedWriter();
+
+        void beginEntries(const std::string& referenceTime, const std::vector<std::string>& validTimes);
+        void beginEntry(const std::string& dataProvider, const std::string& parameter, const std::string& levelName);
+        void setLevel(size_t level);
+        void setVersion(int version, size_t maxVersion);
+        void write(double value, size_t station, size_t time)
+        {
+            size_t shard;
+            switch(key_) {
+            case StationBlock: shard = station / blockSize_; break;
+            case ValidTime: shard = time / blockSize_; break;
+            default: shard = active_; break;
+            }
+            shards_[shard]->write(value, station, time);
+        }
+        void endEntries();
+        void close();
+        PointWriter* fork();
+        void join(PointWriter& block);
+        bool everyStation() const;
+
+        /// Key for --output.shard.key
+        static Key shardKey(const std::string& name);
+
+    private:
+        // block of the parent's current entry: one block of each shard (see fork)
+        ShardedWriter(const ShardedWriter& parent, const Shards& blocks);
+
+        // shards receiving the entry calls: all of them, or only active_ for the parameter key
+        size_t first() const { return key_ == Parameter ? active_ : 0; }
+        size_t last() const { return key_ == Parameter ? active_ + 1 : shards_.size(); }
+
+        Key key_;
+        Loader& controller_;
+        Shards shards_;
+        // stations or times per shard
+        size_t blockSize_;
+        // shard of the current entry (parameter key)
+        size_t active_;
+        // parameter shards, kept across files so a parameter always lands in the same file
+        std::map<std::string, size_t> parameterShards_;
+    };
+
+} } } // end namespaces
+
+#endif // SHARDEDWRITER_HPP
@@ -0,0 +1,152 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "SlabPrefetcher.hpp"
+
+// libfimex
+#include <fimex/CDMException.h>
+
+// boost
+#include <boost/bind.hpp>
+
+// std
+#include <stdexcept>
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+    template<typename T>
+    SlabPrefetcher<T>::SlabPrefetcher(const Reader& reader, size_t reads, size_t depth)
+        : reader_(reader), reads_(reads), depth_(depth), taken_(0), bytes_(0), stalls_(0), stop_(false)
+    {
+        if(depth_ == 0 || reads_ == 0)
+            return;
+
+        thread_ = boost::shared_ptr<boost::thread>(new boost::thread(boost::bind(&SlabPrefetcher<T>::run, this)));
+    }
+
+    template<typename T>
+    SlabPrefetcher<T>::~SlabPrefetcher()
+    {
+        if(thread_.get()) {
+            {
+                boost::mutex::scoped_lock lock(mutex_);
+                stop_ = true;
+            }
+            changed_.notify_all();
+            thread_->join();
+        }
+    }
+
+    template<typename T>
+    boost::shared_array<T> SlabPrefetcher<T>::next(size_t& size)
+    {
+        if(taken_ == reads_)
+            throw runtime_error("No slab left to read");
+
+        if(!thread_.get())
+            return reader_(taken_++, size);
+
+        boost::mutex::scoped_lock lock(mutex_);
+        if(ready_.empty() && !error_)
+            ++stalls_;
+        // the slabs read before a failure are still handed out
+        while(ready_.empty() && !error_)
+            changed_.wait(lock);
+        if(ready_.empty())
+            boost::rethrow_exception(error_);
+
+        Slab slab = ready_.front();
+        ready_.pop_front();
+        bytes_ -= slab.size * sizeof(T);
+        ++taken_;
+        changed_.notify_all();
+
+        size = slab.size;
+        return slab.values;
+    }
+
+    template<typename T>
+    size_t SlabPrefetcher<T>::bytes() const
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        return bytes_;
+    }
+
+    template<typename T>
+    size_t SlabPrefetcher<T>::stalls() const
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        return stalls_;
+    }
+
+    template<typename T>
+    void SlabPrefetcher<T>::run()
+    {
+        boost::mutex::scoped_lock lock(mutex_);
+        for(size_t read = 0; read < reads_; ++read) {
+            while(ready_.size() >= depth_ && !stop_)
+                changed_.wait(lock);
+            if(stop_)
+                return;
+
+            lock.unlock();
+            Slab slab;
+            slab.size = 0;
+            boost::exception_ptr error;
+            try {
+                slab.values = reader_(read, slab.size);
+            } catch (MetNoFimex::CDMException& e) {
+                // current_exception would only keep the std::runtime_error part
+                error = boost::copy_exception(e);
+            } catch (...) {
+                error = boost::current_exception();
+            }
+            lock.lock();
+
+            if(error) {
+                error_ = error;
+                changed_.notify_all();
+                return;
+            }
+            ready_.push_back(slab);
+            bytes_ += slab.size * sizeof(T);
+            changed_.notify_all();
+        }
+    }
+
+    template class SlabPrefetcher<double>;
+    template class SlabPrefetcher<float>;
+
+} } } // end namespaces
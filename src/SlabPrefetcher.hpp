@@ -0,0 +1,114 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef SLABPREFETCHER_HPP
+#define SLABPREFETCHER_HPP
+
+// boost
+#include <boost/exception_ptr.hpp>
+#include <boost/noncopyable.hpp>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
+#include <boost/shared_array.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+// std
+#include <deque>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Reads a known sequence of slabs ahead of the loader.
+      *
+      * With a non-zero depth the slabs are read by a dedicated reader
+      * thread, which keeps up to depth of them waiting in a bounded
+      * queue, so that fimex decoding and interpolation of the next
+      * slab overlap the formatting of the current one. The slabs are
+      * handed out in the order they were read. The reader thread is
+      * the only one to call the reader function; an exception it throws
+      * is rethrown, with its own type, by the next call that would have
+      * returned the failed slab.
+      *
+      * T is the value type of the slabs, double or float (--precision=float).
+      */
+    template<typename T>
+    class SlabPrefetcher : boost::noncopyable
+    {
+    public:
+        /// Reads the slab at a position of the sequence, setting its size
+        typedef boost::function<boost::shared_array<T> (size_t read, size_t& size)> Reader;
+
+        /**
+         * @param reader reads each slab
+         * @param reads  number of slabs in the sequence
+         * @param depth  number of read slabs that may wait for the loader;
+         *               0 reads on the caller's thread
+         */
+        SlabPrefetcher(const Reader& reader, size_t reads, size_t depth);
+        ~SlabPrefetcher();
+
+        /// The next slab of the sequence, waiting for it to be read
+        boost::shared_array<T> next(size_t& size);
+
+        /// Bytes of the slabs read and waiting
+        size_t bytes() const;
+        /// Number of times the loader had to wait for a slab
+        size_t stalls() const;
+
+    private:
+        // reader thread main loop
+        void run();
+
+        struct Slab
+        {
+            boost::shared_array<T> values;
+            size_t size;
+        };
+
+        Reader reader_;
+        size_t reads_;
+        size_t depth_;
+        // slabs handed out by next
+        size_t taken_;
+
+        // reader thread state - guarded by mutex_
+        std::deque<Slab> ready_;
+        size_t bytes_;
+        size_t stalls_;
+        bool stop_;
+        boost::exception_ptr error_;
+        mutable boost::mutex mutex_;
+        boost::condition_variable changed_;
+        boost::shared_ptr<boost::thread> thread_;
+    };
+
+} } } // end namespaces
+
+#endif // SLABPREFETCHER_HPP
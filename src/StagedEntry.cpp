@@ -0,0 +1,288 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "StagedEntry.hpp"
+
+// std
+#include <algorithm>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+
+namespace wdb { namespace load { namespace point {
+
+namespace
+{
+    size_t bitCount(boost::uint64_t bits)
+    {
+#ifdef __GNUC__
+        return __builtin_popcountll(bits);
+#else
+        size_t n = 0;
+        for(; bits != 0; bits &= bits - 1)
+            ++n;
+        return n;
+#endif
+    }
+
+    // one tile; rows and cols are at most StagedEntry::tileSize
+    void transposeTile(const double* src, size_t srcStride, double* dst, size_t dstStride, size_t rows, size_t cols)
+    {
+        size_t r = 0;
+#ifdef __SSE2__
+        // 2x2 blocks: two rows in, two rows out
+        for(; r + 1 < rows; r += 2) {
+            const double* in0 = src + r * srcStride;
+            const double* in1 = in0 + srcStride;
+            size_t c = 0;
+            for(; c + 1 < cols; c += 2) {
+                __m128d a = _mm_loadu_pd(in0 + c);
+                __m128d b = _mm_loadu_pd(in1 + c);
+                _mm_storeu_pd(dst + c * dstStride + r, _mm_unpacklo_pd(a, b));
+                _mm_storeu_pd(dst + (c + 1) * dstStride + r, _mm_unpackhi_pd(a, b));
+            }
+            for(; c < cols; ++c) {
+                dst[c * dstStride + r] = in0[c];
+                dst[c * dstStride + r + 1] = in1[c];
+            }
+        }
+#endif
+        for(; r < rows; ++r) {
+            const double* in = src + r * srcStride;
+            for(size_t c = 0; c < cols; ++c)
+                dst[c * dstStride + r] = in[c];
+        }
+    }
+
+    void transposeTile(const float* src, size_t srcStride, float* dst, size_t dstStride, size_t rows, size_t cols)
+    {
+        size_t r = 0;
+#ifdef __SSE2__
+        // 4x4 blocks: four rows in, four rows out
+        for(; r + 3 < rows; r += 4) {
+            const float* in0 = src + r * srcStride;
+            size_t c = 0;
+            for(; c + 3 < cols; c += 4) {
+                __m128 a = _mm_loadu_ps(in0 + c);
+                __m128 b = _mm_loadu_ps(in0 + srcStride + c);
+                __m128 d = _mm_loadu_ps(in0 + 2 * srcStride + c);
+                __m128 e = _mm_loadu_ps(in0 + 3 * srcStride + c);
+                _MM_TRANSPOSE4_PS(a, b, d, e);
+                _mm_storeu_ps(dst + c * dstStride + r, a);
+                _mm_storeu_ps(dst + (c + 1) * dstStride + r, b);
+                _mm_storeu_ps(dst + (c + 2) * dstStride + r, d);
+                _mm_storeu_ps(dst + (c + 3) * dstStride + r, e);
+            }
+            for(; c < cols; ++c) {
+                for(size_t i = 0; i < 4; ++i)
+                    dst[c * dstStride + r + i] = in0[i * srcStride + c];
+            }
+        }
+#endif
+        for(; r < rows; ++r) {
+            const float* in = src + r * srcStride;
+            for(size_t c = 0; c < cols; ++c)
+                dst[c * dstStride + r] = in[c];
+        }
+    }
+
+    // bit i set for each of the count (at most 64) values that is not NaN
+    boost::uint64_t validBits(const double* values, size_t count)
+    {
+        boost::uint64_t bits = 0;
+        size_t i = 0;
+#ifdef __SSE2__
+        // a value is ordered with itself unless it is NaN
+        for(; i + 1 < count; i += 2) {
+            __m128d v = _mm_loadu_pd(values + i);
+            bits |= boost::uint64_t(_mm_movemask_pd(_mm_cmpord_pd(v, v))) << i;
+        }
+#endif
+        for(; i < count; ++i) {
+            if(values[i] == values[i])
+                bits |= boost::uint64_t(1) << i;
+        }
+        return bits;
+    }
+
+    boost::uint64_t validBits(const float* values, size_t count)
+    {
+        boost::uint64_t bits = 0;
+        size_t i = 0;
+#ifdef __SSE2__
+        for(; i + 3 < count; i += 4) {
+            __m128 v = _mm_loadu_ps(values + i);
+            bits |= boost::uint64_t(_mm_movemask_ps(_mm_cmpord_ps(v, v))) << i;
+        }
+#endif
+        for(; i < count; ++i) {
+            if(values[i] == values[i])
+                bits |= boost::uint64_t(1) << i;
+        }
+        return bits;
+    }
+
+    // transpose of the columns given by stations only: dst[c * dstStride + r] = src[r * srcStride + stations[c]]
+    template<typename T>
+    void gatherTranspose(const T* src, size_t srcStride, const vector<size_t>& stations, T* dst, size_t dstStride, size_t rows)
+    {
+        const size_t tileSize = BasicStagedEntry<T>::tileSize;
+        for(size_t r = 0; r < rows; r += tileSize) {
+            const size_t tileRows = min(tileSize, rows - r);
+            for(size_t c = 0; c < stations.size(); c += tileSize) {
+                const size_t tileCols = min(tileSize, stations.size() - c);
+                for(size_t i = 0; i < tileRows; ++i) {
+                    const T* in = src + (r + i) * srcStride;
+                    T* out = dst + c * dstStride + r + i;
+                    for(size_t j = 0; j < tileCols; ++j)
+                        out[j * dstStride] = in[stations[c + j]];
+                }
+            }
+        }
+    }
+
+    /*
+     * the index arithmetic of stage, specialized on whether the values have
+     * a member and a vertical dimension; chosen once per entry
+     **/
+    template<typename T, bool HasMembers, bool HasLevels>
+    struct StageKernel
+    {
+        static void run(const T* values, size_t stations, const vector<size_t>* active, const vector<size_t>& levelIndexes,
+                        size_t levelLength, size_t members, size_t times, T* staged)
+        {
+            const size_t levels = levelIndexes.size();
+            const size_t memberStride = (HasLevels ? levelLength : 1) * stations;
+            const size_t timeStride = (HasMembers ? members : 1) * memberStride;
+            const size_t seriesStride = levels * (HasMembers ? members : 1) * times;
+            for(size_t l = 0; l < levels; ++l) {
+                const T* level = values + (HasLevels ? levelIndexes[l] * stations : 0);
+                for(size_t m = 0; m < (HasMembers ? members : 1); ++m) {
+                    const T* src = level + (HasMembers ? m * memberStride : 0);
+                    T* dst = staged + (l * (HasMembers ? members : 1) + m) * times;
+                    if(active == 0)
+                        BasicStagedEntry<T>::transpose(src, timeStride, dst, seriesStride, times, stations);
+                    else
+                        gatherTranspose(src, timeStride, *active, dst, seriesStride, times);
+                }
+            }
+        }
+    };
+}
+
+    template<typename T>
+    const size_t BasicStagedEntry<T>::tileSize;
+
+    template<typename T>
+    BasicStagedEntry<T>::BasicStagedEntry() : missing_(0), levels_(0), members_(0), times_(0) { }
+
+    template<typename T>
+    void BasicStagedEntry<T>::stage(const T* values, size_t stations, const vector<size_t>& levelIndexes,
+                                    size_t levelLength, size_t members, size_t times)
+    {
+        stage(values, stations, 0, levelIndexes, levelLength, members, times);
+    }
+
+    template<typename T>
+    void BasicStagedEntry<T>::stage(const T* values, size_t stations, const vector<size_t>& active, const vector<size_t>& levelIndexes,
+                                    size_t levelLength, size_t members, size_t times)
+    {
+        stage(values, stations, active.size() == stations ? 0 : &active, levelIndexes, levelLength, members, times);
+    }
+
+    template<typename T>
+    void BasicStagedEntry<T>::stage(const T* values, size_t stations, const vector<size_t>* active, const vector<size_t>& levelIndexes,
+                                    size_t levelLength, size_t members, size_t times)
+    {
+        levels_ = levelIndexes.size();
+        members_ = members;
+        times_ = times;
+        staged_.resize((active ? active->size() : stations) * levels_ * members_ * times_);
+        if(staged_.empty()) {
+            mask();
+            return;
+        }
+
+        const bool hasMembers = members > 1;
+        const bool hasLevels = levelLength > 1;
+        void (*kernel)(const T*, size_t, const vector<size_t>*, const vector<size_t>&, size_t, size_t, size_t, T*) =
+              hasMembers ? (hasLevels ? &StageKernel<T, true, true>::run : &StageKernel<T, true, false>::run)
+                         : (hasLevels ? &StageKernel<T, false, true>::run : &StageKernel<T, false, false>::run);
+        kernel(values, stations, active, levelIndexes, levelLength, members, times, &staged_[0]);
+        mask();
+    }
+
+    template<typename T>
+    void BasicStagedEntry<T>::release()
+    {
+        vector<T>().swap(staged_);
+        vector<boost::uint64_t>().swap(valid_);
+        missing_ = 0;
+        levels_ = 0;
+        members_ = 0;
+        times_ = 0;
+    }
+
+    template<typename T>
+    void BasicStagedEntry<T>::mask()
+    {
+        const size_t n = staged_.size();
+        valid_.assign(n / 64 + 1, 0);
+        missing_ = 0;
+        for(size_t w = 0; w * 64 < n; ++w) {
+            const size_t count = min<size_t>(64, n - w * 64);
+            const boost::uint64_t bits = validBits(&staged_[w * 64], count);
+            valid_[w] = bits;
+            missing_ += count - bitCount(bits);
+        }
+    }
+
+    template<typename T>
+    void BasicStagedEntry<T>::transpose(const T* src, size_t srcStride, T* dst, size_t dstStride, size_t rows, size_t cols)
+    {
+        for(size_t r = 0; r < rows; r += tileSize) {
+            const size_t tileRows = min(tileSize, rows - r);
+            for(size_t c = 0; c < cols; c += tileSize) {
+                const size_t tileCols = min(tileSize, cols - c);
+                transposeTile(src + r * srcStride + c, srcStride, dst + c * dstStride + r, dstStride, tileRows, tileCols);
+            }
+        }
+    }
+
+    template class BasicStagedEntry<double>;
+    template class BasicStagedEntry<float>;
+
+} } } // end namespaces
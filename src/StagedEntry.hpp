@@ -0,0 +1,169 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef STAGEDENTRY_HPP
+#define STAGEDENTRY_HPP
+
+// boost
+#include <boost/cstdint.hpp>
+#include <boost/noncopyable.hpp>
+
+// std
+#include <algorithm>
+#include <vector>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * The values of one entry rearranged into [station][level][member][time],
+      * the order in which loadEntries writes them.
+      *
+      * fimex delivers [time][member][level][station] (member only for
+      * ensembles), so reading the time series of one station straight from
+      * it jumps a whole time slice per value. Staging transposes each
+      * [time][station] plane once, in cache sized tiles, and the
+      * formatting loop then reads every series sequentially.
+      *
+      * Staging also builds a validity bitmask (one bit per value, clear
+      * for NaN) so that missing values are skipped a word at a time,
+      * and counts them.
+      *
+      * T is double, or float for the single precision path (--precision=float);
+      * both are instantiated in StagedEntry.cpp.
+      */
+    template<typename T>
+    class BasicStagedEntry : boost::noncopyable
+    {
+    public:
+        BasicStagedEntry();
+
+        /**
+         * Stage the requested levels of an entry
+         * @param values        data as read from fimex
+         * @param stations      x * y length
+         * @param levelIndexes  fimex level index of each requested level
+         * @param levelLength   length of the fimex vertical axis (1 without one)
+         * @param members       ensemble members in values (1 when the entry has no member dimension)
+         * @param times         length of the time axis
+         */
+        void stage(const T* values, size_t stations, const std::vector<size_t>& levelIndexes,
+                   size_t levelLength, size_t members, size_t times);
+
+        /**
+         * Stage only the stations listed in active (ascending, see
+         * FileLoader::activeStations); station s of series() is then
+         * station active[s] of the values
+         */
+        void stage(const T* values, size_t stations, const std::vector<size_t>& active, const std::vector<size_t>& levelIndexes,
+                   size_t levelLength, size_t members, size_t times);
+
+        /// Index of the first of the times() values of one station, level (index into levelIndexes) and member
+        size_t seriesIndex(size_t station, size_t level, size_t member) const
+        {
+            return ((station * levels_ + level) * members_ + member) * times_;
+        }
+
+        /// The times() values of one station, level and member
+        const T* series(size_t station, size_t level, size_t member) const
+        {
+            return &staged_[seriesIndex(station, level, member)];
+        }
+
+        /// The staged values
+        const T* data() const { return staged_.empty() ? 0 : &staged_[0]; }
+
+        /// Index of the first value in [index, end) that is not NaN, end if there is none
+        size_t nextValid(size_t index, size_t end) const
+        {
+            while(index < end) {
+                boost::uint64_t bits = valid_[index / 64] >> (index % 64);
+                if(bits != 0)
+                    return std::min(end, index + trailingZeros(bits));
+                index = (index / 64 + 1) * 64;
+            }
+            return end;
+        }
+
+        size_t times() const { return times_; }
+
+        /// Number of values staged
+        size_t size() const { return staged_.size(); }
+
+        /// Number of NaN values staged
+        size_t missing() const { return missing_; }
+
+        /// Free the memory kept for the staged values
+        void release();
+
+        /// Bytes held for the staged values and their mask
+        size_t bytes() const { return staged_.capacity() * sizeof(T) + valid_.capacity() * sizeof(boost::uint64_t); }
+
+        /**
+         * dst[c * dstStride + r] = src[r * srcStride + c] for r < rows, c < cols,
+         * done tile by tile (using SSE2 where the compiler provides it)
+         */
+        static void transpose(const T* src, size_t srcStride, T* dst, size_t dstStride, size_t rows, size_t cols);
+
+        /// Tile edge, in values, used by transpose
+        static const size_t tileSize = 32;
+
+    private:
+        // active is 0 when all stations are staged
+        void stage(const T* values, size_t stations, const std::vector<size_t>* active, const std::vector<size_t>& levelIndexes,
+                   size_t levelLength, size_t members, size_t times);
+
+        // build valid_ and missing_ from staged_
+        void mask();
+
+        // bits is not 0
+        static size_t trailingZeros(boost::uint64_t bits)
+        {
+#ifdef __GNUC__
+            return __builtin_ctzll(bits);
+#else
+            size_t n = 0;
+            for(; (bits & 1) == 0; bits >>= 1)
+                ++n;
+            return n;
+#endif
+        }
+
+        std::vector<T> staged_;
+        std::vector<boost::uint64_t> valid_;
+        size_t missing_;
+        size_t levels_;
+        size_t members_;
+        size_t times_;
+    };
+
+    typedef BasicStagedEntry<double> StagedEntry;
+    typedef BasicStagedEntry<float> StagedEntryFloat;
+
+} } } // end namespaces
+
+#endif // STAGEDENTRY_HPP
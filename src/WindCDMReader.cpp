@@ -0,0 +1,285 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "WindCDMReader.hpp"
+
+// libfimex
+#include <fimex/CDM.h>
+#include <fimex/Data.h>
+
+// boost
+#include <boost/lexical_cast.hpp>
+
+// std
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace MetNoFimex;
+
+namespace wdb { namespace load { namespace point {
+
+namespace
+{
+    // atan on [0, 1] is reduced to [0, tan(pi/8)] around pi/4 and
+    // taken from there by the odd polynomial of the cephes atanf
+    const double TAN_PI_8 = 0.41421356237309503;
+    const double PI_4 = 0.78539816339744831;
+    const double PI_2 = 1.5707963267948966;
+    const double PI = 3.14159265358979324;
+    const double P0 = 8.05374449538e-2;
+    const double P1 = -1.38776856032e-1;
+    const double P2 = 1.99777106478e-1;
+    const double P3 = -3.33329491539e-1;
+
+    // values of winds done at a time, few enough for their u and v to
+    // stay in the L1 cache from the speeds to the libm directions
+    const size_t WIND_CHUNK = 512;
+}
+
+    const double WindCDMReader::PI_ = 3.14159265;
+
+    // measured over a grid of u and v against the libm atan2, about 1e-8 in
+    // double and 1e-6 (two float steps near 2 pi) in float precision
+    const double WindCDMReader::fastDirectionError = 2e-6;
+
+    WindCDMReader::WindCDMReader(boost::shared_ptr<CDMReader> dataReader, const vector<string>& uwinds, const vector<string>& vwinds)
+        : dataReader_(dataReader)
+    {
+        if(uwinds.size() != vwinds.size())
+            throw runtime_error("not the same number of x and y wind components");
+
+        cdm_ = boost::shared_ptr<CDM>(new CDM(dataReader_->getCDM()));
+        for(size_t i = 0; i < uwinds.size(); ++i) {
+            string suffix = i == 0 ? string() : "_" + boost::lexical_cast<string>(i);
+            addVariable("wind_speed" + suffix, uwinds[i], vwinds[i], true);
+            addVariable("wind_from_direction" + suffix, uwinds[i], vwinds[i], false);
+        }
+    }
+
+    WindCDMReader::~WindCDMReader() { }
+
+    void WindCDMReader::addVariable(const string& name, const string& u, const string& v, bool speed)
+    {
+        if(cdm_->hasVariable(name))
+            throw runtime_error("variable " + name + " is already in the data");
+        if(!cdm_->hasVariable(u) || !cdm_->hasVariable(v))
+            throw runtime_error("can't find wind components " + u + " and " + v);
+
+        const CDMVariable& uVariable = cdm_->getVariable(u);
+        cdm_->addVariable(CDMVariable(name, CDM_DOUBLE, uVariable.getShape()));
+        cdm_->addAttribute(name, CDMAttribute("standard_name", speed ? "wind_speed" : "wind_from_direction"));
+        // same values as loaded into wdb; the direction comes out in radians
+        cdm_->addAttribute(name, CDMAttribute("units", speed ? cdm_->getUnits(u) : string("radian")));
+
+        CDMAttribute attribute;
+        if(cdm_->getAttribute(u, "coordinates", attribute))
+            cdm_->addAttribute(name, attribute);
+        if(cdm_->getAttribute(u, "grid_mapping", attribute))
+            cdm_->addAttribute(name, attribute);
+
+        Wind wind = { u, v, speed };
+        winds_[name] = wind;
+    }
+
+    boost::shared_ptr<Data> WindCDMReader::getDataSlice(const string& varName, size_t unLimDimPos)
+    {
+        map<string, Wind>::const_iterator find = winds_.find(varName);
+        if(find == winds_.end())
+            return dataReader_->getDataSlice(varName, unLimDimPos);
+
+        const Wind& wind = find->second;
+        boost::shared_ptr<Data> udata = dataReader_->getScaledDataSlice(wind.u, unLimDimPos);
+        boost::shared_ptr<Data> vdata = dataReader_->getScaledDataSlice(wind.v, unLimDimPos);
+        if(udata->size() != vdata->size())
+            throw runtime_error("datasizes for wind componenets don't match");
+
+        size_t size = udata->size();
+        boost::shared_array<double> u = udata->asDouble();
+        boost::shared_array<double> v = vdata->asDouble();
+        boost::shared_array<double> values(new double[size]);
+        if(wind.speed)
+            winds(u.get(), v.get(), size, values.get(), static_cast<double*>(0));
+        else
+            winds(u.get(), v.get(), size, static_cast<double*>(0), values.get());
+        return createData(size, values);
+    }
+
+    template<typename T>
+    void WindCDMReader::winds(const T* u, const T* v, size_t n, T* speed, T* direction, bool fast)
+    {
+        // a chunk is computed aside before it is stored, so that
+        // the speeds and directions may overwrite u and v
+        T speeds[WIND_CHUNK];
+        T directions[WIND_CHUNK];
+        for(size_t c = 0; c < n; c += WIND_CHUNK) {
+            const size_t m = min(WIND_CHUNK, n - c);
+            size_t t = windBlocks(u + c, v + c, m, speed ? speeds : 0, direction && fast ? directions : 0);
+            for(; t < m; ++t) {
+                if(speed)
+                    speeds[t] = windSpeed(u[c + t], v[c + t]);
+                if(direction && fast)
+                    directions[t] = fastFromDirection(u[c + t], v[c + t]);
+            }
+            if(direction && !fast) {
+                for(t = 0; t < m; ++t)
+                    directions[t] = windFromDirection(u[c + t], v[c + t]);
+            }
+            if(speed)
+                copy(speeds, speeds + m, speed + c);
+            if(direction)
+                copy(directions, directions + m, direction + c);
+        }
+    }
+
+    template<typename T>
+    T WindCDMReader::fastFromDirection(T u, T v)
+    {
+        T ax = std::fabs(u);
+        T ay = std::fabs(v);
+        T mx = ax > ay ? ax : ay;
+        T mn = ax > ay ? ay : ax;
+        T a = mx == T(0) ? T(0) : mn / mx;
+        bool big = a > T(TAN_PI_8);
+        T x = big ? (a - T(1)) / (a + T(1)) : a;
+        T z = x * x;
+        T r = (big ? T(PI_4) : T(0)) + ((((T(P0) * z + T(P1)) * z + T(P2)) * z + T(P3)) * z * x + x);
+        // back from the octant to atan2(v, u)
+        if(ay > ax)
+            r = T(PI_2) - r;
+        if(u < T(0))
+            r = T(PI) - r;
+        if(v < T(0))
+            r = -r;
+        // as windFromDirection, which never needs more than one turn off
+        T dir = T((3/2)*PI_) - r;
+        if(dir > T(2*PI_))
+            dir = dir - T(2*PI_);
+        return dir;
+    }
+
+    size_t WindCDMReader::windBlocks(const double* u, const double* v, size_t n, double* speed, double* direction)
+    {
+        size_t t = 0;
+#ifdef __SSE2__
+        const __m128d sign = _mm_set1_pd(-0.0);
+        const __m128d zero = _mm_setzero_pd();
+        const __m128d one = _mm_set1_pd(1.0);
+        const __m128d twoPi = _mm_set1_pd(2*PI_);
+        for(; t + 2 <= n; t += 2) {
+            __m128d uu = _mm_loadu_pd(u + t);
+            __m128d vv = _mm_loadu_pd(v + t);
+            if(speed)
+                _mm_storeu_pd(speed + t, _mm_sqrt_pd(_mm_add_pd(_mm_mul_pd(uu, uu), _mm_mul_pd(vv, vv))));
+            if(!direction)
+                continue;
+            __m128d ax = _mm_andnot_pd(sign, uu);
+            __m128d ay = _mm_andnot_pd(sign, vv);
+            __m128d steep = _mm_cmpgt_pd(ay, ax);
+            __m128d mx = _mm_or_pd(_mm_and_pd(steep, ay), _mm_andnot_pd(steep, ax));
+            __m128d mn = _mm_or_pd(_mm_and_pd(steep, ax), _mm_andnot_pd(steep, ay));
+            __m128d a = _mm_and_pd(_mm_cmpneq_pd(mx, zero), _mm_div_pd(mn, mx));
+            __m128d big = _mm_cmpgt_pd(a, _mm_set1_pd(TAN_PI_8));
+            __m128d x = _mm_or_pd(_mm_and_pd(big, _mm_div_pd(_mm_sub_pd(a, one), _mm_add_pd(a, one))), _mm_andnot_pd(big, a));
+            __m128d z = _mm_mul_pd(x, x);
+            __m128d p = _mm_add_pd(_mm_mul_pd(_mm_set1_pd(P0), z), _mm_set1_pd(P1));
+            p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(P2));
+            p = _mm_add_pd(_mm_mul_pd(p, z), _mm_set1_pd(P3));
+            p = _mm_add_pd(_mm_mul_pd(_mm_mul_pd(p, z), x), x);
+            __m128d r = _mm_add_pd(_mm_and_pd(big, _mm_set1_pd(PI_4)), p);
+            r = _mm_or_pd(_mm_and_pd(steep, _mm_sub_pd(_mm_set1_pd(PI_2), r)), _mm_andnot_pd(steep, r));
+            __m128d west = _mm_cmplt_pd(uu, zero);
+            r = _mm_or_pd(_mm_and_pd(west, _mm_sub_pd(_mm_set1_pd(PI), r)), _mm_andnot_pd(west, r));
+            r = _mm_xor_pd(r, _mm_and_pd(_mm_cmplt_pd(vv, zero), sign));
+            __m128d dir = _mm_sub_pd(_mm_set1_pd((3/2)*PI_), r);
+            dir = _mm_sub_pd(dir, _mm_and_pd(_mm_cmpgt_pd(dir, twoPi), twoPi));
+            // missing components give missing directions
+            __m128d ordered = _mm_cmpord_pd(uu, vv);
+            _mm_storeu_pd(direction + t, _mm_or_pd(_mm_and_pd(ordered, dir), _mm_andnot_pd(ordered, _mm_add_pd(uu, vv))));
+        }
+#endif
+        return t;
+    }
+
+    size_t WindCDMReader::windBlocks(const float* u, const float* v, size_t n, float* speed, float* direction)
+    {
+        size_t t = 0;
+#ifdef __SSE2__
+        const __m128 sign = _mm_set1_ps(-0.0f);
+        const __m128 zero = _mm_setzero_ps();
+        const __m128 one = _mm_set1_ps(1.0f);
+        const __m128 twoPi = _mm_set1_ps(float(2*PI_));
+        for(; t + 4 <= n; t += 4) {
+            __m128 uu = _mm_loadu_ps(u + t);
+            __m128 vv = _mm_loadu_ps(v + t);
+            if(speed)
+                _mm_storeu_ps(speed + t, _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(uu, uu), _mm_mul_ps(vv, vv))));
+            if(!direction)
+                continue;
+            __m128 ax = _mm_andnot_ps(sign, uu);
+            __m128 ay = _mm_andnot_ps(sign, vv);
+            __m128 steep = _mm_cmpgt_ps(ay, ax);
+            __m128 mx = _mm_or_ps(_mm_and_ps(steep, ay), _mm_andnot_ps(steep, ax));
+            __m128 mn = _mm_or_ps(_mm_and_ps(steep, ax), _mm_andnot_ps(steep, ay));
+            __m128 a = _mm_and_ps(_mm_cmpneq_ps(mx, zero), _mm_div_ps(mn, mx));
+            __m128 big = _mm_cmpgt_ps(a, _mm_set1_ps(float(TAN_PI_8)));
+            __m128 x = _mm_or_ps(_mm_and_ps(big, _mm_div_ps(_mm_sub_ps(a, one), _mm_add_ps(a, one))), _mm_andnot_ps(big, a));
+            __m128 z = _mm_mul_ps(x, x);
+            __m128 p = _mm_add_ps(_mm_mul_ps(_mm_set1_ps(float(P0)), z), _mm_set1_ps(float(P1)));
+            p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(float(P2)));
+            p = _mm_add_ps(_mm_mul_ps(p, z), _mm_set1_ps(float(P3)));
+            p = _mm_add_ps(_mm_mul_ps(_mm_mul_ps(p, z), x), x);
+            __m128 r = _mm_add_ps(_mm_and_ps(big, _mm_set1_ps(float(PI_4))), p);
+            r = _mm_or_ps(_mm_and_ps(steep, _mm_sub_ps(_mm_set1_ps(float(PI_2)), r)), _mm_andnot_ps(steep, r));
+            __m128 west = _mm_cmplt_ps(uu, zero);
+            r = _mm_or_ps(_mm_and_ps(west, _mm_sub_ps(_mm_set1_ps(float(PI)), r)), _mm_andnot_ps(west, r));
+            r = _mm_xor_ps(r, _mm_and_ps(_mm_cmplt_ps(vv, zero), sign));
+            __m128 dir = _mm_sub_ps(_mm_set1_ps(float((3/2)*PI_)), r);
+            dir = _mm_sub_ps(dir, _mm_and_ps(_mm_cmpgt_ps(dir, twoPi), twoPi));
+            // missing components give missing directions
+            __m128 ordered = _mm_cmpord_ps(uu, vv);
+            _mm_storeu_ps(direction + t, _mm_or_ps(_mm_and_ps(ordered, dir), _mm_andnot_ps(ordered, _mm_add_ps(uu, vv))));
+        }
+#endif
+        return t;
+    }
+
+    template void WindCDMReader::winds<double>(const double* u, const double* v, size_t n, double* speed, double* direction, bool fast);
+    template void WindCDMReader::winds<float>(const float* u, const float* v, size_t n, float* speed, float* direction, bool fast);
+
+} } } // end namespaces
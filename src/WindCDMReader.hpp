@@ -0,0 +1,124 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifndef WINDCDMREADER_HPP
+#define WINDCDMREADER_HPP
+
+// libfimex
+#include <fimex/CDMReader.h>
+
+// boost
+#include <boost/shared_ptr.hpp>
+
+// std
+#include <cmath>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace wdb { namespace load { namespace point {
+
+    /**
+      * Adds wind speed and wind from direction to a CDMReader holding
+      * rotated u and v wind components (see fimex.process.rotateVectorToLatLonX/Y).
+      *
+      * For each u/v pair the variables wind_speed and wind_from_direction
+      * (suffixed _1, _2 ... for further pairs) get the shape and coordinates
+      * of the u component. Their data are computed slice by slice when read;
+      * all other variables are passed through unchanged.
+      */
+    class WindCDMReader : public MetNoFimex::CDMReader
+    {
+    public:
+        WindCDMReader(boost::shared_ptr<MetNoFimex::CDMReader> dataReader,
+                      const std::vector<std::string>& uwinds, const std::vector<std::string>& vwinds);
+        ~WindCDMReader();
+
+        using MetNoFimex::CDMReader::getDataSlice;
+        boost::shared_ptr<MetNoFimex::Data> getDataSlice(const std::string& varName, size_t unLimDimPos);
+
+        /// Wind speed from the u and v components, as loaded into wdb (T is double or float)
+        template<typename T>
+        static T windSpeed(T u, T v)
+        {
+            return std::sqrt(u*u + v*v);
+        }
+
+        /// Wind from direction from the u and v components, as loaded into wdb
+        template<typename T>
+        static T windFromDirection(T u, T v)
+        {
+            T dir = T((3/2)*PI_) - std::atan2(v, u);
+            while(dir > T(2*PI_)) {
+                dir = dir - T(2*PI_);
+            }
+            return dir;
+        }
+
+        /**
+         * Wind speeds and from directions of n u and v components in one pass,
+         * a chunk of them at a time; either output may be 0. Speeds are those
+         * of windSpeed, computed in SSE2 blocks; directions are those of
+         * windFromDirection or, with fast, of a vectorized atan2 approximation
+         * within fastDirectionError of it (for finite components, NaN stays NaN).
+         * The outputs may be the inputs (speed u, direction v) to save memory
+         */
+        template<typename T>
+        static void winds(const T* u, const T* v, size_t n, T* speed, T* direction, bool fast = false);
+
+        /// Bound, in radians, on the difference of the fast directions from windFromDirection
+        static const double fastDirectionError;
+
+    private:
+        static const double PI_;
+
+        // the fast direction of one u and v pair, as the vectorized blocks compute it
+        template<typename T>
+        static T fastFromDirection(T u, T v);
+
+        // the SSE2 blocks of winds, returns the number of values done
+        static size_t windBlocks(const double* u, const double* v, size_t n, double* speed, double* direction);
+        static size_t windBlocks(const float* u, const float* v, size_t n, float* speed, float* direction);
+
+        struct Wind
+        {
+            std::string u;
+            std::string v;
+            bool speed;
+        };
+
+        // add one derived variable, modelled on the u component
+        void addVariable(const std::string& name, const std::string& u, const std::string& v, bool speed);
+
+        boost::shared_ptr<MetNoFimex::CDMReader> dataReader_;
+        std::map<std::string, Wind> winds_;
+    };
+
+} } } // end namespaces
+
+#endif // WINDCDMREADER_HPP
@@ -0,0 +1,108 @@
+/*
+ wdb
+
+ Copyright (C) 2012 met.no
+
+ Contact information:
+ Norwegian Meteorological Institute
+ Box 43 Blindern
+ 0313 OSLO
+ NORWAY
+ E-mail: wdb@met.no
+
+ This program is free software; you can redistribute it and/or modify
+ it under the terms of the GNU General Public License as published by
+ the Free Software Foundation; either version 2 of the License, or
+ (at your option) any later version.
+
+ This program is distributed in the hope that it will be useful,
+ but WITHOUT ANY WARRANTY; without even the implied warranty of
+ MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ GNU General Public License for more details.
+
+ You should have received a copy of the GNU General Public License
+ along with this program; if not, write to the Free Software
+ Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston,
+ MA  02110-1301, USA
+*/
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+// project
+#include "BinaryPointReader.hpp"
+#include "CopyBinaryReader.hpp"
+#include "CopyBinaryWriter.hpp"
+#include "ColumnarReader.hpp"
+
+// std
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <exception>
+
+using namespace std;
+
+//// Support Functions
+namespace
+{
+    /**
+      * Write help information to stream
+      * @param	out			Stream to write to
+      */
+    void help( ostream & out )
+    {
+        out << PACKAGE_STRING << endl;
+        out << '\n';
+        out << "Usage: pointValueDecode [FILE]\n\n";
+        out << "Expands binary output from pointValueLoad (--output.format=binary,\n"
+               "copy or columnar) into the wdb-fastload text format. Reads standard\n"
+               "input when no FILE is given (not for columnar, which needs a file)\n"
+               "and writes to standard output.\n";
+    }
+
+    /**
+      * Decode in to standard output; the format is told by the first byte
+      * @param	in			Stream to read from
+      */
+    void decode( istream & in )
+    {
+        if(in.peek() == wdb::load::point::CopyBinaryWriter::signature[0]) {
+            wdb::load::point::CopyBinaryReader reader(in);
+            reader.decode(cout);
+        } else if(in.peek() == wdb::load::point::columnar::magic[0]) {
+            wdb::load::point::ColumnarReader reader(in);
+            reader.decode(cout);
+        } else {
+            wdb::load::point::BinaryPointReader reader(in);
+            reader.decode(cout);
+        }
+    }
+} // namespace
+
+int main(int argc, char ** argv)
+{
+    if(argc > 2 || (argc == 2 && (strcmp(argv[1], "--help") == 0 || strcmp(argv[1], "-h") == 0))) {
+        help(argc > 2 ? clog : cout);
+        return argc > 2 ? 1 : 0;
+    }
+
+    try {
+        ios_base::sync_with_stdio(false);
+        if(argc == 2 && strcmp(argv[1], "-") != 0) {
+            ifstream in(argv[1], ios::in | ios::binary);
+            if(!in)
+                throw runtime_error(string("Unable to open ") + argv[1]);
+            decode(in);
+        } else {
+            decode(cin);
+        }
+        cout.flush();
+    } catch(std::exception& e) {
+        cerr << "Reason: " << e.what() << endl;
+        return 1;
+    }
+
+    return 0;
+}
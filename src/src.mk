@@ -13,6 +13,24 @@ SOURCE = src/CmdLine.cpp \
 					 src/GribHandleReader.cpp \
                      src/FileLoader.cpp \
 					 src/NetCDFLoader.cpp \
+					 src/OutputWriter.cpp \
+					 src/Compressor.cpp \
+					 src/LineFormatter.cpp \
+					 src/StagedEntry.cpp \
+					 src/PointWriter.cpp \
+					 src/FastloadWriter.cpp \
+					 src/BinaryPointWriter.cpp \
+					 src/BinaryPointReader.cpp \
+					 src/CopyBinaryWriter.cpp \
+					 src/CopyBinaryReader.cpp \
+					 src/ColumnarWriter.cpp \
+					 src/ColumnarReader.cpp \
+					 src/ShardedWriter.cpp \
+					 src/WindCDMReader.cpp \
+					 src/DomainCDMReader.cpp \
+					 src/CDMIndex.cpp \
+					 src/SlabPrefetcher.cpp \
+					 src/ReadCache.cpp \
 					 src/CmdLine.hpp \
 					 src/CfgFileReader.hpp \
 				     src/FeltLoader.hpp \
@@ -23,11 +41,32 @@ SOURCE = src/CmdLine.cpp \
 					 src/GribFile.hpp \
 					 src/GribHandleReader.hpp \
                      src/FileLoader.hpp \
-					 src/NetCDFLoader.hpp
+					 src/NetCDFLoader.hpp \
+					 src/OutputWriter.hpp \
+					 src/Compressor.hpp \
+					 src/LineFormatter.hpp \
+					 src/StagedEntry.hpp \
+					 src/PointWriter.hpp \
+					 src/FastloadWriter.hpp \
+					 src/BinaryPointWriter.hpp \
+					 src/BinaryPointReader.hpp \
+					 src/CopyBinaryWriter.hpp \
+					 src/CopyBinaryReader.hpp \
+					 src/ColumnarWriter.hpp \
+					 src/ColumnarReader.hpp \
+					 src/ShardedWriter.hpp \
+					 src/WindCDMReader.hpp \
+					 src/DomainCDMReader.hpp \
+					 src/CDMIndex.hpp \
+					 src/SlabPrefetcher.hpp \
+					 src/ReadCache.hpp
 
 libpointvalueload_a_SOURCES += $(SOURCE)
 
 pointValueLoad_SOURCES = \
                   src/main.cpp
 
+pointValueDecode_SOURCES = \
+                  src/decode.cpp
+
 EXTRA_DIST +=		src/src.mk